@@ -4,7 +4,12 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <string_view>
 #include <map>
+#include <list>
+#include <array>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <algorithm>
 #include <cctype>
@@ -13,6 +18,47 @@
 #include <functional>
 #include <regex>
 #include <fstream> // For file operations
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <coroutine>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <random>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <malloc.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define CONTACT_BOOK_IO_URING 1
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 // Forward declarations
 class InputValidator;
@@ -27,8 +73,19 @@ private:
     std::string email;          // Email address
     std::string address;        // Physical address
     std::string birthdate;      // Birthdate
+    std::string city;           // City/municipality recognized from the address (not persisted)
+    std::string province;       // Province recognized from the address (not persisted)
+    uint64_t id = 0;            // Identifier assigned by ContactBook (not persisted)
+    uint64_t version = 0;       // Bumped on every committed change (not persisted)
+    uint64_t lastAccess = 0;    // Access tick for memory-limit eviction (not persisted)
+    uint64_t spillOffset = NOT_SPILLED; // Copy of the body in the spill file, if any
+    uint64_t spilledVersion = 0;        // Version the spilled copy was taken from
+    uint64_t slot = 0;          // Record in the slot file, if one is attached (not persisted)
+    bool evicted = false;       // Name, email and address live only in the spill file
 
 public:
+    static constexpr uint64_t NOT_SPILLED = UINT64_MAX;
+
     // Default constructor
     Contact() = default;
 
@@ -40,11 +97,20 @@ public:
           address(address), birthdate(birthdate) {}
 
     // Getter methods
-    std::string getName() const { return name; }
-    std::string getPhoneNumber() const { return phoneNumber; }
-    std::string getEmail() const { return email; }
-    std::string getAddress() const { return address; }
-    std::string getBirthdate() const { return birthdate; }
+    const std::string& getName() const { return name; }
+    const std::string& getPhoneNumber() const { return phoneNumber; }
+    const std::string& getEmail() const { return email; }
+    const std::string& getAddress() const { return address; }
+    const std::string& getBirthdate() const { return birthdate; }
+    const std::string& getCity() const { return city; }
+    const std::string& getProvince() const { return province; }
+    uint64_t getId() const { return id; }
+    uint64_t getVersion() const { return version; }
+    uint64_t getLastAccess() const { return lastAccess; }
+    uint64_t getSpillOffset() const { return spillOffset; }
+    uint64_t getSpilledVersion() const { return spilledVersion; }
+    uint64_t getSlot() const { return slot; }
+    bool isEvicted() const { return evicted; }
 
     // Setter methods
     void setName(const std::string& name) { this->name = name; }
@@ -52,187 +118,5813 @@ public:
     void setEmail(const std::string& email) { this->email = email; }
     void setAddress(const std::string& address) { this->address = address; }
     void setBirthdate(const std::string& birthdate) { this->birthdate = birthdate; }
+    void setLocality(const std::string& city, const std::string& province) {
+        this->city = city;
+        this->province = province;
+    }
+    void setId(uint64_t id) { this->id = id; }
+    void setVersion(uint64_t version) { this->version = version; }
+    void setLastAccess(uint64_t tick) { lastAccess = tick; }
+    void setSlot(uint64_t slot) { this->slot = slot; }
+
+    // Drops name, email and address, whose copy is at offset in the spill file.
+    // Phone and birthdate fit in the string objects themselves and stay.
+    void evict(uint64_t offset) {
+        spillOffset = offset;
+        spilledVersion = version;
+        name = std::string();
+        email = std::string();
+        address = std::string();
+        evicted = true;
+    }
+
+    // Restores the fields dropped by evict()
+    void restore(std::string name, std::string email, std::string address) {
+        this->name = std::move(name);
+        this->email = std::move(email);
+        this->address = std::move(address);
+        evicted = false;
+    }
 };
 
-// Error messages class for centralized message management
-class ErrorMessages {
+/*
+ * Memory accounting: approximate heap bytes of the containers used by the
+ * contact book, for the metrics exporter. Node overheads assume a 64-bit
+ * libstdc++ layout.
+ */
+inline size_t heapBytes(const std::string& text) {
+    // Short strings live inside the object
+    return text.capacity() > 15 ? text.capacity() + 1 : 0;
+}
+
+inline size_t heapBytes(const Contact& contact) {
+    return heapBytes(contact.getName()) + heapBytes(contact.getPhoneNumber()) + heapBytes(contact.getEmail()) +
+           heapBytes(contact.getAddress()) + heapBytes(contact.getBirthdate()) +
+           heapBytes(contact.getCity()) + heapBytes(contact.getProvince());
+}
+
+template<typename Map, typename ValueBytes>
+size_t hashMapBytes(const Map& map, ValueBytes valueBytes) {
+    size_t bytes = map.bucket_count() * sizeof(void*);
+    for (const auto& [key, value] : map) {
+        bytes += sizeof(typename Map::value_type) + 2 * sizeof(void*) + valueBytes(value);
+        if constexpr (std::is_same_v<std::decay_t<decltype(key)>, std::string>) bytes += heapBytes(key);
+    }
+    return bytes;
+}
+
+inline size_t setBytes(const std::set<uint64_t>& ids) {
+    return ids.size() * (4 * sizeof(void*) + sizeof(uint64_t));
+}
+
+/*
+ * Crc32c Class: CRC-32C (Castagnoli) checksums for persisted files. Uses
+ * the SSE4.2 crc32 instruction when the CPU has it (checked at run time)
+ * and slicing-by-8 tables otherwise.
+ */
+class Crc32c {
 public:
-    static std::string nameLength(size_t maxLength) {
-        return "Name must be between 2 and " + 
-               std::to_string(maxLength) + " characters.";
+    // Checksum of data, continuing from crc when given the checksum of the preceding bytes
+    static uint32_t compute(const void* data, size_t length, uint32_t crc = 0) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+#if defined(__x86_64__)
+        static const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+        if (hasSse42) return ~updateSse42(~crc, bytes, length);
+#endif
+        return ~updateTables(~crc, bytes, length);
     }
-    
-    static std::string nameFormat() {
-        return "Name must contain only letters and spaces.";
+
+    static uint32_t compute(std::string_view text, uint32_t crc = 0) { return compute(text.data(), text.size(), crc); }
+
+    // Eight lowercase hex digits
+    static std::string hex(uint32_t crc) {
+        char buffer[9];
+        std::snprintf(buffer, sizeof(buffer), "%08x", crc);
+        return buffer;
     }
-    
-    static std::string phoneFormat() {
-        return "Phone number must be 11 digits starting with '09' (e.g., 09244561530)";
+
+    static std::optional<uint32_t> parseHex(std::string_view text) {
+        if (text.size() != 8) return std::nullopt;
+        uint32_t crc = 0;
+        for (char c : text) {
+            int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            if (digit < 0) return std::nullopt;
+            crc = crc << 4 | static_cast<uint32_t>(digit);
+        }
+        return crc;
     }
-    
-    static std::string emailFormat() {
-        return "Invalid email format. Example: user@domain.com";
+
+private:
+    static constexpr uint32_t POLYNOMIAL = 0x82F63B78;     // Reflected Castagnoli polynomial
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    // tables[k][b] is the CRC of byte b followed by k zero bytes
+    static constexpr Tables makeTables() {
+        Tables tables{};
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+            tables[0][b] = crc;
+        }
+        for (size_t k = 1; k < 8; ++k) {
+            for (size_t b = 0; b < 256; ++b) {
+                tables[k][b] = (tables[k - 1][b] >> 8) ^ tables[0][tables[k - 1][b] & 0xFF];
+            }
+        }
+        return tables;
     }
-    
-    static std::string birthdateFormat() {
-        return "Birthdate must be in format: DD/MM/YYYY";
+
+    static uint32_t load32(const unsigned char* p) {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
     }
-    
-    static std::string addressLength(size_t maxLength) {
-        return "Address must be between 5 and " + 
-               std::to_string(maxLength) + " characters.";
+
+    static uint32_t updateTables(uint32_t crc, const unsigned char* p, size_t length) {
+        static constexpr Tables TABLES = makeTables();
+        for (; length >= 8; p += 8, length -= 8) {
+            uint32_t low = load32(p) ^ crc;
+            uint32_t high = load32(p + 4);
+            crc = TABLES[7][low & 0xFF] ^ TABLES[6][(low >> 8) & 0xFF] ^
+                  TABLES[5][(low >> 16) & 0xFF] ^ TABLES[4][low >> 24] ^
+                  TABLES[3][high & 0xFF] ^ TABLES[2][(high >> 8) & 0xFF] ^
+                  TABLES[1][(high >> 16) & 0xFF] ^ TABLES[0][high >> 24];
+        }
+        for (; length > 0; ++p, --length) crc = TABLES[0][(crc ^ *p) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    static uint32_t updateSse42(uint32_t crc, const unsigned char* p, size_t length) {
+        uint64_t wide = crc;
+        for (; length >= 8; p += 8, length -= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            wide = _mm_crc32_u64(wide, word);
+        }
+        crc = static_cast<uint32_t>(wide);
+        for (; length > 0; ++p, --length) crc = _mm_crc32_u8(crc, *p);
+        return crc;
     }
+#endif
 };
 
-// Input validation class
-class InputValidator {
+/*
+ * ChecksumLines Struct: Integrity lines of the line-based text files. A
+ * checksummed file starts with HEADER, and each block of records is
+ * followed by "#crc32c <records> <crc>", the CRC-32C of the bytes between
+ * the previous header or checksum line and this one. Files without the
+ * header are read as before, unchecked.
+ */
+struct ChecksumLines {
+    static constexpr std::string_view HEADER = "#contact-book v1 crc32c";
+    static constexpr std::string_view TRAILER_PREFIX = "#crc32c ";
+
+    struct Trailer {
+        size_t records;
+        uint32_t crc;
+    };
+
+    static std::string trailer(size_t records, uint32_t crc) {
+        return std::string(TRAILER_PREFIX) + std::to_string(records) + " " + Crc32c::hex(crc);
+    }
+
+    static bool isTrailer(std::string_view line) { return line.substr(0, TRAILER_PREFIX.size()) == TRAILER_PREFIX; }
+
+    // Fields of a trailer line, or nullopt if it is malformed
+    static std::optional<Trailer> parseTrailer(std::string_view line) {
+        if (!isTrailer(line)) return std::nullopt;
+        line.remove_prefix(TRAILER_PREFIX.size());
+        size_t space = line.find(' ');
+        if (space == 0 || space == std::string_view::npos || space > 12) return std::nullopt;
+        size_t records = 0;
+        for (char c : line.substr(0, space)) {
+            if (!std::isdigit(static_cast<unsigned char>(c))) return std::nullopt;
+            records = records * 10 + static_cast<size_t>(c - '0');
+        }
+        std::optional<uint32_t> crc = Crc32c::parseHex(line.substr(space + 1));
+        if (!crc) return std::nullopt;
+        return Trailer{records, *crc};
+    }
+};
+
+/*
+ * ChaCha20Poly1305 Class: The ChaCha20-Poly1305 AEAD of RFC 8439 in
+ * portable C++. seal() encrypts in place and returns the 16-byte tag;
+ * open() checks the tag in constant time before decrypting in place.
+ */
+class ChaCha20Poly1305 {
 public:
-    static constexpr size_t MAX_TEXT_LENGTH = 100;
-    static constexpr size_t MIN_NAME_LENGTH = 2;
-    static constexpr size_t MIN_ADDRESS_LENGTH = 5;
+    static constexpr size_t KEY_SIZE = 32;
+    static constexpr size_t NONCE_SIZE = 12;
+    static constexpr size_t TAG_SIZE = 16;
+    using Key = std::array<uint8_t, KEY_SIZE>;
+    using Nonce = std::array<uint8_t, NONCE_SIZE>;
+    using Tag = std::array<uint8_t, TAG_SIZE>;
 
-    // Validate name (letters and spaces only)
-    static bool isValidName(const std::string& name) {
-        if (name.length() < MIN_NAME_LENGTH || name.length() > MAX_TEXT_LENGTH) return false;
-        return std::all_of(name.begin(), name.end(), 
-            [](char c) { return std::isalpha(c) || std::isspace(c); });
+    static Tag seal(const Key& key, const Nonce& nonce, std::string_view aad, uint8_t* data, size_t length) {
+        xorStream(key, nonce, 1, data, length);
+        return mac(key, nonce, aad, data, length);
     }
 
-    // Validate phone number format (Philippine format)
-    static bool isValidPhoneNumber(const std::string& phone) {
-        // Check if it's exactly 11 digits and starts with '09'
-        if (phone.length() != 11 || phone.substr(0, 2) != "09") return false;
-        return std::all_of(phone.begin(), phone.end(), ::isdigit);
+    static bool open(const Key& key, const Nonce& nonce, std::string_view aad, uint8_t* data, size_t length,
+                     const uint8_t* tag) {
+        Tag expected = mac(key, nonce, aad, data, length);
+        uint8_t difference = 0;
+        for (size_t i = 0; i < TAG_SIZE; ++i) difference |= expected[i] ^ tag[i];
+        if (difference != 0) return false;
+        xorStream(key, nonce, 1, data, length);
+        return true;
     }
 
-    // Format phone number for display (convert 09XXXXXXXXX to +63 (XXX) XXX XXXX)
-    static std::string formatPhoneNumber(const std::string& phone) {
-        if (phone.length() != 11 || phone.substr(0, 2) != "09") return phone;
-        
-        std::string areaCode = phone.substr(1, 3);
-        std::string firstPart = phone.substr(4, 3);
-        std::string secondPart = phone.substr(7, 4);
-        
-        return "+63 (" + areaCode + ") " + firstPart + " " + secondPart;
+private:
+    static uint32_t load32(const uint8_t* p) {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    static uint64_t load64(const uint8_t* p) { return load32(p) | uint64_t(load32(p + 4)) << 32; }
+
+    static void store32(uint8_t* p, uint32_t value) {
+        for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(value >> (8 * i));
     }
 
-    // Validate email format
-    static bool isValidEmail(const std::string& email) {
-        std::regex emailPattern(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})");
-        return std::regex_match(email, emailPattern);
+    static void store64(uint8_t* p, uint64_t value) {
+        store32(p, static_cast<uint32_t>(value));
+        store32(p + 4, static_cast<uint32_t>(value >> 32));
     }
 
-    // Validate birthdate format (DD/MM/YYYY)
-    static bool isValidBirthdate(const std::string& date) {
-        std::regex datePattern(R"((\d{2})/(\d{2})/(\d{4}))");
-        if (!std::regex_match(date, datePattern)) return false;
-        
-        int day = std::stoi(date.substr(0, 2));
-        int month = std::stoi(date.substr(3, 2));
-        int year = std::stoi(date.substr(6, 4));
-        
-        if (month < 1 || month > 12) return false;
-        if (day < 1 || day > 31) return false;
-        if (year < 1900 || year > 2025) return false;
-        
+    static void quarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+        a += b; d = std::rotl(d ^ a, 16);
+        c += d; b = std::rotl(b ^ c, 12);
+        a += b; d = std::rotl(d ^ a, 8);
+        c += d; b = std::rotl(b ^ c, 7);
+    }
+
+    // One 64-byte keystream block
+    static void block(const uint32_t (&input)[16], uint8_t* out) {
+        uint32_t x[16];
+        std::copy(std::begin(input), std::end(input), x);
+        for (int round = 0; round < 10; ++round) {
+            quarterRound(x[0], x[4], x[8], x[12]);
+            quarterRound(x[1], x[5], x[9], x[13]);
+            quarterRound(x[2], x[6], x[10], x[14]);
+            quarterRound(x[3], x[7], x[11], x[15]);
+            quarterRound(x[0], x[5], x[10], x[15]);
+            quarterRound(x[1], x[6], x[11], x[12]);
+            quarterRound(x[2], x[7], x[8], x[13]);
+            quarterRound(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) store32(out + 4 * i, x[i] + input[i]);
+    }
+
+    static void initialState(const Key& key, const Nonce& nonce, uint32_t counter, uint32_t (&state)[16]) {
+        state[0] = 0x61707865;
+        state[1] = 0x3320646e;
+        state[2] = 0x79622d32;
+        state[3] = 0x6b206574;
+        for (int i = 0; i < 8; ++i) state[4 + i] = load32(key.data() + 4 * i);
+        state[12] = counter;
+        for (int i = 0; i < 3; ++i) state[13 + i] = load32(nonce.data() + 4 * i);
+    }
+
+    static void xorStream(const Key& key, const Nonce& nonce, uint32_t counter, uint8_t* data, size_t length) {
+        uint32_t state[16];
+        initialState(key, nonce, counter, state);
+        size_t offset = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        if (hasAvx2) {
+            offset = length / 512 * 512;
+            xorBlocksAvx2(state, data, offset / 64);
+            state[12] += static_cast<uint32_t>(offset / 64);
+        }
+#endif
+        uint8_t stream[64];
+        for (; offset < length; offset += 64) {
+            block(state, stream);
+            ++state[12];
+            size_t n = std::min<size_t>(64, length - offset);
+            for (size_t i = 0; i < n; ++i) data[offset + i] ^= stream[i];
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2")))
+    static __m256i rotate(__m256i v, int bits) {
+        return _mm256_or_si256(_mm256_slli_epi32(v, bits), _mm256_srli_epi32(v, 32 - bits));
+    }
+
+    __attribute__((target("avx2")))
+    static void quarterRoundAvx2(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+        const __m256i rotate16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                                  2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+        const __m256i rotate8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                                 3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+        a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate16);
+        c = _mm256_add_epi32(c, d); b = rotate(_mm256_xor_si256(b, c), 12);
+        a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rotate8);
+        c = _mm256_add_epi32(c, d); b = rotate(_mm256_xor_si256(b, c), 7);
+    }
+
+    /*
+     * XORs the keystream into blocks 64-byte blocks of data (a multiple of
+     * eight), eight blocks at a time: vector x[i] holds word i of each of
+     * them, and is transposed back to byte order when storing.
+     */
+    __attribute__((target("avx2")))
+    static void xorBlocksAvx2(const uint32_t (&state)[16], uint8_t* data, size_t blocks) {
+        for (size_t first = 0; first < blocks; first += 8) {
+            __m256i input[16], x[16];
+            for (int i = 0; i < 16; ++i) input[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+            input[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(state[12] + first)),
+                                         _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            std::copy(std::begin(input), std::end(input), x);
+            for (int round = 0; round < 10; ++round) {
+                quarterRoundAvx2(x[0], x[4], x[8], x[12]);
+                quarterRoundAvx2(x[1], x[5], x[9], x[13]);
+                quarterRoundAvx2(x[2], x[6], x[10], x[14]);
+                quarterRoundAvx2(x[3], x[7], x[11], x[15]);
+                quarterRoundAvx2(x[0], x[5], x[10], x[15]);
+                quarterRoundAvx2(x[1], x[6], x[11], x[12]);
+                quarterRoundAvx2(x[2], x[7], x[8], x[13]);
+                quarterRoundAvx2(x[3], x[4], x[9], x[14]);
+            }
+            for (int i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], input[i]);
+
+            // Words 0-7, then 8-15, of the eight blocks
+            for (int half = 0; half < 2; ++half) {
+                const __m256i* w = x + 8 * half;
+                __m256i t0 = _mm256_unpacklo_epi32(w[0], w[1]), t1 = _mm256_unpackhi_epi32(w[0], w[1]);
+                __m256i t2 = _mm256_unpacklo_epi32(w[2], w[3]), t3 = _mm256_unpackhi_epi32(w[2], w[3]);
+                __m256i t4 = _mm256_unpacklo_epi32(w[4], w[5]), t5 = _mm256_unpackhi_epi32(w[4], w[5]);
+                __m256i t6 = _mm256_unpacklo_epi32(w[6], w[7]), t7 = _mm256_unpackhi_epi32(w[6], w[7]);
+                __m256i low[4] = {_mm256_unpacklo_epi64(t0, t2), _mm256_unpackhi_epi64(t0, t2),
+                                  _mm256_unpacklo_epi64(t1, t3), _mm256_unpackhi_epi64(t1, t3)};
+                __m256i high[4] = {_mm256_unpacklo_epi64(t4, t6), _mm256_unpackhi_epi64(t4, t6),
+                                   _mm256_unpacklo_epi64(t5, t7), _mm256_unpackhi_epi64(t5, t7)};
+                for (int j = 0; j < 4; ++j) {
+                    // low[j]/high[j] hold block j in their lower lanes and block j + 4 in the upper ones
+                    for (int upper = 0; upper < 2; ++upper) {
+                        __m256i stream = _mm256_permute2x128_si256(low[j], high[j], upper ? 0x31 : 0x20);
+                        auto* out = reinterpret_cast<__m256i*>(data + 64 * (first + j + 4 * upper) + 32 * half);
+                        _mm256_storeu_si256(out, _mm256_xor_si256(_mm256_loadu_si256(out), stream));
+                    }
+                }
+            }
+        }
+    }
+#endif
+
+    /*
+     * Poly1305 over aad and ciphertext as RFC 8439 section 2.8 lays them
+     * out, keyed by the first block of the stream. Uses 44/44/42-bit limbs
+     * with 128-bit products.
+     */
+    static Tag mac(const Key& key, const Nonce& nonce, std::string_view aad, const uint8_t* data, size_t length) {
+        using u128 = unsigned __int128;
+        constexpr uint64_t MASK44 = 0xfffffffffff, MASK42 = 0x3ffffffffff;
+        uint32_t state[16];
+        initialState(key, nonce, 0, state);
+        uint8_t polyKey[64];
+        block(state, polyKey);
+
+        uint64_t t0 = load64(polyKey), t1 = load64(polyKey + 8);
+        const uint64_t r0 = t0 & 0xffc0fffffff;
+        const uint64_t r1 = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffff;
+        const uint64_t r2 = (t1 >> 24) & 0x00ffffffc0f;
+        const uint64_t s1 = r1 * (5 << 2), s2 = r2 * (5 << 2);
+        uint64_t h0 = 0, h1 = 0, h2 = 0;
+
+        auto absorb = [&](const uint8_t* m, uint64_t highBit) {
+            uint64_t m0 = load64(m), m1 = load64(m + 8);
+            h0 += m0 & MASK44;
+            h1 += ((m0 >> 44) | (m1 << 20)) & MASK44;
+            h2 += (((m1 >> 24)) & MASK42) | highBit;
+            u128 d0 = u128(h0) * r0 + u128(h1) * s2 + u128(h2) * s1;
+            u128 d1 = u128(h0) * r1 + u128(h1) * r0 + u128(h2) * s2;
+            u128 d2 = u128(h0) * r2 + u128(h1) * r1 + u128(h2) * r0;
+            uint64_t c = static_cast<uint64_t>(d0 >> 44);
+            h0 = static_cast<uint64_t>(d0) & MASK44;
+            d1 += c;
+            c = static_cast<uint64_t>(d1 >> 44);
+            h1 = static_cast<uint64_t>(d1) & MASK44;
+            d2 += c;
+            c = static_cast<uint64_t>(d2 >> 42);
+            h2 = static_cast<uint64_t>(d2) & MASK42;
+            h0 += c * 5;
+            c = h0 >> 44;
+            h0 &= MASK44;
+            h1 += c;
+        };
+        // Whole 16-byte blocks, then the zero-padded rest
+        auto absorbPadded = [&](const uint8_t* m, size_t n) {
+            for (; n >= 16; m += 16, n -= 16) absorb(m, uint64_t(1) << 40);
+            if (n > 0) {
+                uint8_t last[16] = {};
+                std::memcpy(last, m, n);
+                absorb(last, uint64_t(1) << 40);
+            }
+        };
+        absorbPadded(reinterpret_cast<const uint8_t*>(aad.data()), aad.size());
+        absorbPadded(data, length);
+        uint8_t lengths[16];
+        store64(lengths, aad.size());
+        store64(lengths + 8, length);
+        absorb(lengths, uint64_t(1) << 40);
+
+        // Full carry, then subtract p = 2^130 - 5 if h >= p
+        uint64_t c = h1 >> 44; h1 &= MASK44;
+        h2 += c; c = h2 >> 42; h2 &= MASK42;
+        h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+        h1 += c; c = h1 >> 44; h1 &= MASK44;
+        h2 += c; c = h2 >> 42; h2 &= MASK42;
+        h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+        h1 += c;
+        uint64_t g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+        uint64_t g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+        uint64_t g2 = h2 + c - (uint64_t(1) << 42);
+        c = (g2 >> 63) - 1;     // All ones if h >= p
+        h0 = (h0 & ~c) | (g0 & c);
+        h1 = (h1 & ~c) | (g1 & c);
+        h2 = (h2 & ~c) | (g2 & c);
+
+        // h + s mod 2^128
+        t0 = load64(polyKey + 16);
+        t1 = load64(polyKey + 24);
+        h0 += t0 & MASK44; c = h0 >> 44; h0 &= MASK44;
+        h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c; c = h1 >> 44; h1 &= MASK44;
+        h2 += ((t1 >> 24) & MASK42) + c; h2 &= MASK42;
+        Tag tag;
+        store64(tag.data(), h0 | (h1 << 44));
+        store64(tag.data() + 8, (h1 >> 20) | (h2 << 24));
+        return tag;
+    }
+};
+
+/*
+ * SealedBlocks Struct: Encrypted form of a line-based file. After a
+ * 16-byte header (MAGIC and a random 8-byte nonce prefix) the plaintext
+ * follows as a sequence of blocks, each a 4-byte length, that many bytes of
+ * ChaCha20-Poly1305 ciphertext and the tag. Block i is sealed with the
+ * nonce prefix followed by i, and its length and whether it is the last
+ * block are authenticated with it, so blocks can be opened independently
+ * (and in parallel) while reordering, dropping or truncating them is
+ * detected. Lengths are little-endian.
+ */
+struct SealedBlocks {
+    static constexpr std::string_view MAGIC = "CBSEAL1\n";
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t BLOCK_HEADER_SIZE = 4;
+    static constexpr size_t OVERHEAD = BLOCK_HEADER_SIZE + ChaCha20Poly1305::TAG_SIZE;
+    static constexpr size_t MAX_BLOCK_SIZE = size_t(1) << 30;
+    static constexpr const char* KEY_VARIABLE = "CONTACT_BOOK_KEY";
+
+    using Key = ChaCha20Poly1305::Key;
+    using Prefix = std::array<uint8_t, 8>;
+
+    // A key written as 64 hex digits, or nullopt
+    static std::optional<Key> parseKey(std::string_view hex) {
+        if (hex.size() != 2 * Key().size()) return std::nullopt;
+        Key key;
+        for (size_t i = 0; i < hex.size(); ++i) {
+            char c = static_cast<char>(std::tolower(static_cast<unsigned char>(hex[i])));
+            int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+            if (digit < 0) return std::nullopt;
+            key[i / 2] = static_cast<uint8_t>(i % 2 == 0 ? digit << 4 : key[i / 2] | digit);
+        }
+        return key;
+    }
+
+    static Prefix randomPrefix() {
+        std::random_device device;
+        Prefix prefix;
+        for (size_t i = 0; i < prefix.size(); i += 4) {
+            uint32_t value = device();
+            std::memcpy(prefix.data() + i, &value, 4);
+        }
+        return prefix;
+    }
+
+    static std::string header(const Prefix& prefix) {
+        std::string header(MAGIC);
+        header.append(reinterpret_cast<const char*>(prefix.data()), prefix.size());
+        return header;
+    }
+
+    static bool isSealed(std::string_view data) { return data.substr(0, MAGIC.size()) == MAGIC; }
+
+    static Prefix prefixOf(std::string_view header) {
+        Prefix prefix;
+        std::memcpy(prefix.data(), header.data() + MAGIC.size(), prefix.size());
+        return prefix;
+    }
+
+    // Bytes of ciphertext in the block starting at data (BLOCK_HEADER_SIZE available)
+    static size_t blockLength(const char* data) {
+        return static_cast<uint8_t>(data[0]) | size_t(static_cast<uint8_t>(data[1])) << 8 |
+               size_t(static_cast<uint8_t>(data[2])) << 16 | size_t(static_cast<uint8_t>(data[3])) << 24;
+    }
+
+    /*
+     * Seals block index in place. buffer holds BLOCK_HEADER_SIZE bytes of
+     * room followed by the plaintext; the length is filled in and the tag
+     * appended.
+     */
+    static void seal(const Key& key, const Prefix& prefix, uint32_t index, bool last, std::string& buffer) {
+        size_t length = buffer.size() - BLOCK_HEADER_SIZE;
+        for (size_t i = 0; i < BLOCK_HEADER_SIZE; ++i) buffer[i] = static_cast<char>(length >> (8 * i));
+        auto tag = ChaCha20Poly1305::seal(key, nonce(prefix, index), associatedData(buffer.data(), last),
+                                          reinterpret_cast<uint8_t*>(buffer.data() + BLOCK_HEADER_SIZE), length);
+        buffer.append(reinterpret_cast<const char*>(tag.data()), tag.size());
+    }
+
+    // Opens the whole block at data into out; false if it fails authentication
+    static bool open(const Key& key, const Prefix& prefix, uint32_t index, bool last, const char* data,
+                     std::string& out) {
+        size_t length = blockLength(data);
+        out.assign(data + BLOCK_HEADER_SIZE, length);
+        return ChaCha20Poly1305::open(key, nonce(prefix, index), associatedData(data, last),
+                                      reinterpret_cast<uint8_t*>(out.data()), length,
+                                      reinterpret_cast<const uint8_t*>(data + BLOCK_HEADER_SIZE + length));
+    }
+
+private:
+    static ChaCha20Poly1305::Nonce nonce(const Prefix& prefix, uint32_t index) {
+        ChaCha20Poly1305::Nonce nonce{};
+        std::copy(prefix.begin(), prefix.end(), nonce.begin());
+        for (size_t i = 0; i < 4; ++i) nonce[prefix.size() + i] = static_cast<uint8_t>(index >> (8 * i));
+        return nonce;
+    }
+
+    // The block's length bytes followed by a last-block flag
+    static std::string associatedData(const char* lengthBytes, bool last) {
+        std::string aad(lengthBytes, BLOCK_HEADER_SIZE);
+        aad.push_back(last ? '\1' : '\0');
+        return aad;
+    }
+};
+
+/*
+ * Allocation counting: every global operator new bumps a process-wide
+ * counter, and the counter of the operation the thread is working for, if
+ * any. An AllocationScope names that operation for a thread; pool tasks
+ * carry the scope of the thread that queued them, so an operation's count
+ * covers its own pool work and nothing that runs beside it.
+ */
+std::atomic<uint64_t> allocationCount{0};
+thread_local std::atomic<uint64_t>* operationAllocations = nullptr;
+
+void* operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (std::atomic<uint64_t>* counter = operationAllocations) counter->fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (std::atomic<uint64_t>* counter = operationAllocations) counter->fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+// Kept out of line so the compiler pairs new/delete rather than malloc/free
+[[gnu::noinline]] void operator delete(void* memory) noexcept { std::free(memory); }
+[[gnu::noinline]] void operator delete[](void* memory) noexcept { std::free(memory); }
+[[gnu::noinline]] void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+[[gnu::noinline]] void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+// Counts this thread's allocations into counter (none if null) until destroyed
+class AllocationScope {
+public:
+    explicit AllocationScope(std::atomic<uint64_t>* counter)
+        : previous(std::exchange(operationAllocations, counter)) {}
+    ~AllocationScope() { operationAllocations = previous; }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    std::atomic<uint64_t>* previous;
+};
+
+// Parks a coroutine's allocation counter while it is suspended, so whatever
+// its thread runs in the meantime is not charged to it
+class SuspendedAllocations {
+public:
+    void suspend() {
+        counter = std::exchange(operationAllocations, nullptr);
+        suspended = true;
+    }
+    void resume() {
+        if (suspended) operationAllocations = counter;
+    }
+
+private:
+    std::atomic<uint64_t>* counter = nullptr;
+    bool suspended = false;
+};
+
+/*
+ * ThreadPool Class: Work-stealing task scheduler shared by all parallel
+ * ContactBook operations (search, load, validation, sort).
+ *
+ * Every worker owns a pair of deques, one per priority. A worker pops its
+ * own newest task first and, when idle, steals the oldest task from another
+ * worker. Interactive tasks are always drained (locally and by stealing)
+ * before any background task is started, so a user-facing search never
+ * waits behind a background rebuild that has not begun yet. Tasks spawned
+ * from inside a pool task (e.g. the chunks of a parallelFor in a
+ * background load) run at no higher priority than the task itself, and a
+ * background parallelFor runs any queued interactive tasks between its
+ * chunks, so a search waits at most one chunk for a running load.
+ */
+enum class TaskPriority { Interactive = 0, Background = 1 };
+
+class ThreadPool {
+public:
+    // Snapshot of scheduler counters
+    struct Metrics {
+        size_t workerCount = 0;
+        size_t queuedInteractive = 0;
+        size_t queuedBackground = 0;
+        size_t maxWorkerDepth = 0;      // Deepest single worker deque
+        uint64_t executed = 0;
+        uint64_t steals = 0;
+    };
+
+    explicit ThreadPool(size_t workerCount = std::thread::hardware_concurrency()) {
+        workerCount = std::max<size_t>(1, workerCount);
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < workerCount; ++i) {
+            threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        sleepCondition.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Submit a task and get a future for its result
+    template<typename Function>
+    auto submit(Function&& function, TaskPriority priority = TaskPriority::Interactive)
+        -> std::future<decltype(function())> {
+        using Result = decltype(function());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> result = task->get_future();
+        enqueue([task] { (*task)(); }, priority);
+        return result;
+    }
+
+    /*
+     * Runs body(begin, end) over [0, count) split into chunks of chunkSize.
+     * The calling thread works through chunks as well, so this is safe to
+     * call from inside a pool task without starving the pool.
+     */
+    template<typename Body>
+    void parallelFor(size_t count, size_t chunkSize, Body body,
+                     TaskPriority priority = TaskPriority::Interactive) {
+        if (count == 0) return;
+        chunkSize = std::max<size_t>(1, chunkSize);
+        size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        if (chunkCount == 1) {
+            body(size_t(0), count);
+            return;
+        }
+
+        struct SharedState {
+            std::atomic<size_t> nextChunk{0};
+            std::atomic<size_t> inFlight{0};
+            std::mutex mutex;
+            std::condition_variable done;
+        };
+        auto state = std::make_shared<SharedState>();
+
+        bool background = std::max(priority, currentPriority()) == TaskPriority::Background;
+        auto runChunks = [this, state, count, chunkSize, chunkCount, background, &body] {
+            while (true) {
+                state->inFlight.fetch_add(1);
+                size_t chunk = state->nextChunk.fetch_add(1);
+                if (chunk >= chunkCount) {
+                    if (state->inFlight.fetch_sub(1) == 1) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->done.notify_all();
+                    }
+                    return;
+                }
+                size_t begin = chunk * chunkSize;
+                body(begin, std::min(count, begin + chunkSize));
+                if (state->inFlight.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->done.notify_all();
+                }
+                if (background) runQueuedInteractive();
+            }
+        };
+
+        // Helpers only touch body while the caller is still waiting below
+        size_t helperCount = std::min(workers.size(), chunkCount - 1);
+        for (size_t i = 0; i < helperCount; ++i) {
+            enqueue(runChunks, priority);
+        }
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&state] { return state->inFlight.load() == 0; });
+    }
+
+    Metrics metrics() const {
+        Metrics snapshot;
+        snapshot.workerCount = workers.size();
+        for (const auto& worker : workers) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            size_t interactive = worker->queues[0].size();
+            size_t background = worker->queues[1].size();
+            snapshot.queuedInteractive += interactive;
+            snapshot.queuedBackground += background;
+            snapshot.maxWorkerDepth = std::max(snapshot.maxWorkerDepth, interactive + background);
+        }
+        snapshot.executed = executedCount.load();
+        snapshot.steals = stealCount.load();
+        return snapshot;
+    }
+
+private:
+    struct Task {
+        std::function<void()> run;
+        std::atomic<uint64_t>* allocations = nullptr;  // Operation counter of the thread that queued it
+    };
+
+    struct Worker {
+        mutable std::mutex mutex;
+        std::deque<Task> queues[2];     // Indexed by TaskPriority
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<size_t> pendingTasks{0};
+    std::atomic<size_t> nextVictim{0};
+    std::atomic<uint64_t> executedCount{0};
+    std::atomic<uint64_t> stealCount{0};
+    std::atomic<size_t> interactiveQueued{0};   // Interactive tasks waiting in any deque
+    bool stopping = false;
+
+    // Index of the worker running on this thread, if any
+    static size_t& currentWorkerIndex() {
+        static thread_local size_t index = SIZE_MAX;
+        return index;
+    }
+
+    // Priority of the task running on this thread; Interactive outside the pool
+    static TaskPriority& currentPriority() {
+        static thread_local TaskPriority priority = TaskPriority::Interactive;
+        return priority;
+    }
+
+    void enqueue(std::function<void()> function, TaskPriority priority) {
+        priority = std::max(priority, currentPriority());
+        Task task{std::move(function), operationAllocations};
+        // Tasks spawned by a worker stay local; external ones are spread out
+        size_t target = currentWorkerIndex();
+        if (target >= workers.size()) {
+            target = nextVictim.fetch_add(1) % workers.size();
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            pendingTasks.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mutex);
+            workers[target]->queues[static_cast<int>(priority)].push_back(std::move(task));
+            if (priority == TaskPriority::Interactive) interactiveQueued.fetch_add(1);
+        }
+        sleepCondition.notify_one();
+    }
+
+    bool popLocal(size_t self, int level, Task& task) {
+        Worker& worker = *workers[self];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        auto& queue = worker.queues[level];
+        if (queue.empty()) return false;
+        task = std::move(queue.back());
+        queue.pop_back();
+        if (level == 0) interactiveQueued.fetch_sub(1);
         return true;
     }
 
-    // Validate address length
-    static bool isValidAddress(const std::string& address) {
-        return address.length() >= MIN_ADDRESS_LENGTH && address.length() <= MAX_TEXT_LENGTH;
+    bool steal(size_t self, int level, Task& task) {
+        for (size_t offset = 1; offset < workers.size(); ++offset) {
+            Worker& victim = *workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            auto& queue = victim.queues[level];
+            if (queue.empty()) continue;
+            task = std::move(queue.front());
+            queue.pop_front();
+            if (level == 0) interactiveQueued.fetch_sub(1);
+            stealCount.fetch_add(1);
+            return true;
+        }
+        return false;
     }
 
-    // Template for getting valid input with custom validation
-    template<typename Validator>
-    static std::string getValidInput(
-        const std::string& prompt,
-        Validator validator,
-        const std::string& errorMsg,
-        bool allowEmpty = false
-    ) {
-        std::string input;
+    bool findTask(size_t self, Task& task) {
+        for (int level = 0; level < 2; ++level) {
+            if (popLocal(self, level, task) || steal(self, level, task)) {
+                currentPriority() = static_cast<TaskPriority>(level);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs the interactive tasks queued anywhere on this thread, at interactive priority
+    void runQueuedInteractive() {
+        size_t self = currentWorkerIndex() < workers.size() ? currentWorkerIndex() : 0;
+        Task task;
+        while (interactiveQueued.load() > 0 && (popLocal(self, 0, task) || steal(self, 0, task))) {
+            pendingTasks.fetch_sub(1);
+            TaskPriority previous = std::exchange(currentPriority(), TaskPriority::Interactive);
+            {
+                AllocationScope scope(task.allocations);
+                task.run();
+            }
+            currentPriority() = previous;
+            executedCount.fetch_add(1);
+        }
+    }
+
+    void workerLoop(size_t self) {
+        currentWorkerIndex() = self;
         while (true) {
-            std::cout << prompt;
-            std::getline(std::cin, input);
-            if (allowEmpty && input.empty()) break;
-            if (validator(input)) break;
-            std::cout << "\nError: " << errorMsg << "\n\n";
+            Task task;
+            if (findTask(self, task)) {
+                pendingTasks.fetch_sub(1);
+                {
+                    AllocationScope scope(task.allocations);
+                    task.run();
+                }
+                executedCount.fetch_add(1);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCondition.wait(lock, [this] { return stopping || pendingTasks.load() > 0; });
+            if (stopping && pendingTasks.load() == 0) return;
         }
-        return input;
     }
 };
 
 /*
- * ContactBook Class: Manages the entire contact book operations
+ * FileDescriptor Class: Owns a POSIX file descriptor and closes it on
+ * destruction
  */
-class ContactBook {
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd = -1) : fd(fd) {}
+    ~FileDescriptor() { close(); }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    FileDescriptor(FileDescriptor&& other) noexcept : fd(std::exchange(other.fd, -1)) {}
+    FileDescriptor& operator=(FileDescriptor&& other) noexcept {
+        if (this != &other) {
+            close();
+            fd = std::exchange(other.fd, -1);
+        }
+        return *this;
+    }
+
+    int get() const { return fd; }
+    explicit operator bool() const { return fd >= 0; }
+
+    // Closes the descriptor now; false if close reported an error
+    bool close() {
+        if (fd < 0) return true;
+        int result = ::close(fd);
+        fd = -1;
+        return result == 0;
+    }
+
 private:
-    std::vector<Contact> contacts;
+    int fd;
+};
 
-    // Helper function to get input
-    std::string getInput(const std::string& prompt) const {
-        std::cout << prompt;
-        std::string input;
-        std::getline(std::cin, input);
-        return input;
+/*
+ * AsyncIo Class: Positioned reads and writes with many requests in flight.
+ * On Linux the requests go to an io_uring driven through raw system calls.
+ * Where io_uring is unavailable (older kernels, seccomp filters, other
+ * systems, or CONTACT_BOOK_IO=threads) each request runs as pread/pwrite on
+ * the thread pool instead. An instance is used by one thread at a time;
+ * requests still in flight are waited for on destruction, so buffers must
+ * outlive it.
+ */
+class AsyncIo {
+public:
+    using Ticket = uint64_t;
+
+    explicit AsyncIo(ThreadPool& pool, unsigned depth = DEFAULT_DEPTH) : pool(pool) {
+#ifdef CONTACT_BOOK_IO_URING
+        if (ioUringAllowed() && !setUpRing(depth)) {
+            tearDownRing();
+            ioUringFailed().store(true);
+        }
+#else
+        (void)depth;
+#endif
     }
 
-    // Converts string to uppercase for case-insensitive comparisons
-    std::string toUpper(const std::string& str) const {
-        std::string upper = str;
-        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-        return upper;
+    ~AsyncIo() {
+        while (!pending.empty()) wait(pending.begin()->first);
+#ifdef CONTACT_BOOK_IO_URING
+        tearDownRing();
+#endif
     }
 
-    // Clears the console screen for better UI
-    void clearScreen() const {
-        #ifdef _WIN32
-            system("cls");
-        #else
+    AsyncIo(const AsyncIo&) = delete;
+    AsyncIo& operator=(const AsyncIo&) = delete;
+
+    const char* backend() const { return ringFd >= 0 ? "io_uring" : "thread pool"; }
+
+    Ticket read(int fd, void* buffer, size_t length, uint64_t offset) {
+        return submit({fd, static_cast<char*>(buffer), length, offset, false});
+    }
+
+    Ticket write(int fd, const void* buffer, size_t length, uint64_t offset) {
+        return submit({fd, static_cast<char*>(const_cast<void*>(buffer)), length, offset, true});
+    }
+
+    // Waits for a request; returns the bytes transferred (fewer than asked
+    // only at the end of a file) or -errno
+    int64_t wait(Ticket ticket) {
+        auto it = pending.find(ticket);
+        if (it == pending.end()) return -EINVAL;
+        Request request = it->second.request;
+        std::shared_ptr<PoolRequest> queued = std::move(it->second.queued);
+        pending.erase(it);
+
+        int64_t result;
+        if (queued) {
+            result = waitPool(*queued, request);
+        } else {
+            result = waitRing(ticket);
+            if (result == -EINVAL) result = 0;      // Kernel without IORING_OP_READ/WRITE; finish below
+        }
+        // Complete short transfers synchronously
+        if (result >= 0 && static_cast<size_t>(result) < request.length) result = transfer(request, result);
+        return result;
+    }
+
+private:
+    static constexpr unsigned DEFAULT_DEPTH = 64;
+
+    struct Request {
+        int fd;
+        char* buffer;
+        size_t length;
+        uint64_t offset;
+        bool write;
+    };
+
+    // Fallback request; whichever of a worker or the waiter claims it first runs it
+    struct PoolRequest {
+        enum State { Queued, Running, Done };
+        std::atomic<int> state{Queued};
+        int64_t result = 0;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    struct Pending {
+        Request request;
+        std::shared_ptr<PoolRequest> queued;    // Null for io_uring requests
+    };
+
+    ThreadPool& pool;
+    std::unordered_map<Ticket, Pending> pending;
+    Ticket nextTicket = 1;
+    int ringFd = -1;
+
+    Ticket submit(const Request& request) {
+        Ticket ticket = nextTicket++;
+        Pending entry{request, nullptr};
+        if (ringFd < 0 || !submitRing(request, ticket)) {
+            auto queued = std::make_shared<PoolRequest>();
+            pool.submit([queued, request] {
+                int expected = PoolRequest::Queued;
+                if (!queued->state.compare_exchange_strong(expected, PoolRequest::Running)) return;
+                int64_t result = transfer(request, 0);
+                std::lock_guard<std::mutex> lock(queued->mutex);
+                queued->result = result;
+                queued->state.store(PoolRequest::Done);
+                queued->done.notify_all();
+            });
+            entry.queued = std::move(queued);
+        }
+        pending.emplace(ticket, std::move(entry));
+        return ticket;
+    }
+
+    // Runs the request here if no worker has started it, so waiting from a
+    // pool thread cannot deadlock
+    static int64_t waitPool(PoolRequest& queued, const Request& request) {
+        int expected = PoolRequest::Queued;
+        if (queued.state.compare_exchange_strong(expected, PoolRequest::Running)) return transfer(request, 0);
+        std::unique_lock<std::mutex> lock(queued.mutex);
+        queued.done.wait(lock, [&queued] { return queued.state.load() == PoolRequest::Done; });
+        return queued.result;
+    }
+
+    // pread/pwrite from byte done until the request is complete or a read hits the end of the file
+    static int64_t transfer(const Request& request, int64_t done) {
+        size_t total = static_cast<size_t>(done);
+        while (total < request.length) {
+            char* data = request.buffer + total;
+            size_t length = request.length - total;
+            off_t offset = static_cast<off_t>(request.offset + total);
+            ssize_t result = request.write ? pwrite(request.fd, data, length, offset)
+                                           : pread(request.fd, data, length, offset);
+            if (result < 0 && errno == EINTR) continue;
+            if (result < 0) return -errno;
+            if (result == 0) {
+                if (request.write) return -EIO;
+                break;
+            }
+            total += static_cast<size_t>(result);
+        }
+        return static_cast<int64_t>(total);
+    }
+
+#ifdef CONTACT_BOOK_IO_URING
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned sqEntries = 0;
+    unsigned inFlight = 0;
+    std::unordered_map<Ticket, int64_t> completed;
+
+    // Set once io_uring_setup has failed, so later instances skip it
+    static std::atomic<bool>& ioUringFailed() {
+        static std::atomic<bool> failed{false};
+        return failed;
+    }
+
+    static bool ioUringAllowed() {
+        static const bool forcedOff = [] {
+            const char* setting = std::getenv("CONTACT_BOOK_IO");
+            return setting && std::string(setting) == "threads";
+        }();
+        return !forcedOff && !ioUringFailed().load();
+    }
+
+    bool setUpRing(unsigned depth) {
+        io_uring_params params{};
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0) return false;
+        ringFd = fd;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        auto map = [fd](size_t size, off_t offset) -> void* {
+            void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+            return address == MAP_FAILED ? nullptr : address;
+        };
+        sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+        if (!sqRing) return false;
+        cqRing = singleMap ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+        if (!cqRing) return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(map(sqesSize, IORING_OFF_SQES));
+        if (!sqes) return false;
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        sqEntries = params.sq_entries;
+        return true;
+    }
+
+    void tearDownRing() {
+        if (sqes) munmap(sqes, sqesSize);
+        if (cqRing && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) ::close(ringFd);
+        sqes = nullptr;
+        sqRing = cqRing = nullptr;
+        ringFd = -1;
+    }
+
+    int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+        while (true) {
+            int result = static_cast<int>(syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, nullptr, 0));
+            if (result >= 0 || errno != EINTR) return result;
+        }
+    }
+
+    // Queues one request; false if the kernel refused it
+    bool submitRing(const Request& request, Ticket ticket) {
+        while (inFlight >= sqEntries) reap(true);
+        unsigned tail = *sqTail;
+        unsigned slot = tail & *sqMask;
+        io_uring_sqe& sqe = sqes[slot];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd = request.fd;
+        sqe.addr = reinterpret_cast<uint64_t>(request.buffer);
+        sqe.len = static_cast<uint32_t>(std::min<size_t>(request.length, UINT32_MAX));
+        sqe.off = request.offset;
+        sqe.user_data = ticket;
+        sqArray[slot] = slot;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        if (enter(1, 0, 0) != 1) {
+            // Not consumed by the kernel; take the entry back
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+            return false;
+        }
+        ++inFlight;
+        return true;
+    }
+
+    // Moves finished requests into completed, blocking for one if asked
+    void reap(bool block) {
+        while (true) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            if (head != tail) {
+                for (; head != tail; ++head) {
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    completed[cqe.user_data] = cqe.res;
+                    --inFlight;
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+                return;
+            }
+            if (!block) return;
+            if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EAGAIN && errno != EBUSY) return;
+        }
+    }
+
+    int64_t waitRing(Ticket ticket) {
+        while (true) {
+            auto it = completed.find(ticket);
+            if (it != completed.end()) {
+                int64_t result = it->second;
+                completed.erase(it);
+                return result;
+            }
+            if (inFlight == 0) return -EIO;     // The ring stopped delivering completions
+            reap(true);
+        }
+    }
+#else
+    int64_t waitRing(Ticket) { return -ENOSYS; }
+    bool submitRing(const Request&, Ticket) { return false; }
+#endif
+};
+
+/*
+ * CancellationToken Class: Cooperative cancellation flag that long-running
+ * operations check at chunk boundaries
+ */
+class CancellationToken {
+private:
+    std::atomic<bool> cancelled{false};
+
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    void reset() { cancelled.store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+};
+
+/*
+ * InterruptGuard Class: While in scope, Ctrl-C cancels the given token
+ * instead of terminating the program. Outside any guard the default SIGINT
+ * behaviour is restored.
+ */
+class InterruptGuard {
+private:
+    using Handler = void (*)(int);
+    Handler previousHandler;
+
+    static std::atomic<CancellationToken*>& activeToken() {
+        static std::atomic<CancellationToken*> token{nullptr};
+        return token;
+    }
+
+    static void handleInterrupt(int) {
+        if (CancellationToken* token = activeToken().load()) token->cancel();
+    }
+
+public:
+    explicit InterruptGuard(CancellationToken& token) {
+        token.reset();
+        activeToken().store(&token);
+        previousHandler = std::signal(SIGINT, handleInterrupt);
+    }
+
+    ~InterruptGuard() {
+        std::signal(SIGINT, previousHandler);
+        activeToken().store(nullptr);
+    }
+
+    InterruptGuard(const InterruptGuard&) = delete;
+    InterruptGuard& operator=(const InterruptGuard&) = delete;
+};
+
+/*
+ * ProgressReporter Class: Thread-safe progress line (records processed,
+ * percentage and ETA) for long operations. Work is measured in units, which
+ * may be records or bytes; small jobs are not reported at all.
+ */
+class ProgressReporter {
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string label;
+    size_t totalUnits;
+    bool enabled;
+    std::atomic<size_t> doneUnits{0};
+    std::atomic<size_t> doneRecords{0};
+    Clock::time_point startTime = Clock::now();
+    Clock::time_point lastPrint = startTime;
+    std::mutex printMutex;
+    bool printed = false;
+
+public:
+    static constexpr size_t MIN_REPORTED_UNITS = 100000;
+    static constexpr auto PRINT_INTERVAL = std::chrono::milliseconds(200);
+
+    ProgressReporter(const std::string& label, size_t totalUnits)
+        : label(label), totalUnits(totalUnits), enabled(totalUnits >= MIN_REPORTED_UNITS) {}
+
+    ~ProgressReporter() { finish(); }
+
+    size_t recordsProcessed() const { return doneRecords.load(); }
+
+    // Record progress; callable from any worker thread
+    void advance(size_t records, size_t units) {
+        doneRecords.fetch_add(records);
+        size_t done = doneUnits.fetch_add(units) + units;
+        if (!enabled) return;
+
+        std::unique_lock<std::mutex> lock(printMutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        auto now = Clock::now();
+        if (now - lastPrint < PRINT_INTERVAL) return;
+        lastPrint = now;
+
+        double elapsed = std::chrono::duration<double>(now - startTime).count();
+        double fraction = totalUnits ? std::min(1.0, double(done) / totalUnits) : 1.0;
+        double eta = fraction > 0 ? elapsed * (1.0 - fraction) / fraction : 0.0;
+        std::cout << '\r' << label << ": " << doneRecords.load() << " records ("
+                  << std::fixed << std::setprecision(1) << fraction * 100.0 << "%), ETA "
+                  << std::setprecision(0) << eta << "s  (Ctrl-C to cancel)   " << std::flush;
+        std::cout.unsetf(std::ios::floatfield);
+        printed = true;
+    }
+
+    void advance(size_t records) { advance(records, records); }
+
+    // Clear the progress line once the operation ends
+    void finish() {
+        std::lock_guard<std::mutex> lock(printMutex);
+        if (printed) {
+            std::cout << '\r' << std::string(79, ' ') << '\r' << std::flush;
+            printed = false;
+        }
+    }
+};
+
+/*
+ * Task Class: Lazily started C++20 coroutine returning T. Awaiting a task
+ * starts it and resumes the awaiting coroutine when it finishes; exceptions
+ * thrown inside the task are rethrown at the co_await.
+ */
+template<typename T = void>
+class Task;
+
+template<typename T>
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto next = handle.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase<T> {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+
+    T takeResult() {
+        if (this->error) std::rethrow_exception(this->error);
+        return std::move(*value);
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase<void> {
+    Task<void> get_return_object();
+    void return_void() {}
+
+    void takeResult() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+template<typename T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { if (handle) handle.destroy(); }
+
+    bool done() const { return !handle || handle.done(); }
+    void start() { handle.resume(); }
+    T result() { return handle.promise().takeResult(); }
+
+    bool await_ready() const noexcept { return done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().takeResult(); }
+
+private:
+    Handle handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+// Thrown from EventLoop::readLine() once the terminal input is closed
+class InputClosedError : public std::runtime_error {
+public:
+    InputClosedError() : std::runtime_error("input closed") {}
+};
+
+/*
+ * Input lines as seen by a session recording. A pause is a line read only
+ * to acknowledge a message ("Press Enter to continue..."); replays skip
+ * them instead of waiting.
+ */
+enum class InputKind { Line, Pause };
+
+struct InputRecord {
+    int64_t elapsedMs = 0;      // Milliseconds since the recording started
+    InputKind kind = InputKind::Line;
+    std::string text;
+};
+
+/*
+ * EventLoop Class: Single-threaded epoll loop driving the interactive front
+ * end. Terminal input, timers and completions of work handed to the thread
+ * pool are multiplexed here, so coroutines waiting for the user never block
+ * the thread that runs timers and background completions.
+ */
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    EventLoop() {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0) {
+            throw std::runtime_error(std::string("event loop setup failed: ") + std::strerror(errno));
+        }
+        addWatch(wakeFd);
+        // Regular files cannot be polled; they are read directly on demand
+        inputPollable = addWatch(STDIN_FILENO);
+    }
+
+    ~EventLoop() {
+        close(wakeFd);
+        close(epollFd);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // Drive the loop until the given task has finished
+    void run(Task<void>& main) {
+        main.start();
+        while (!main.done()) {
+            runPosted();
+            runDueTimers();
+            if (main.done()) break;
+
+            if (!inputPollable && lineWaiter) {
+                readInput();
+                continue;
+            }
+
+            epoll_event events[8];
+            int ready = epoll_wait(epollFd, events, 8, nextTimeoutMs());
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("epoll_wait failed: ") + std::strerror(errno));
+            }
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.fd == wakeFd) {
+                    uint64_t count;
+                    while (read(wakeFd, &count, sizeof(count)) > 0) {}
+                } else if (events[i].data.fd == STDIN_FILENO) {
+                    readInput();
+                }
+            }
+        }
+        main.result();
+    }
+
+    // Queue a callback to run on the loop thread; callable from any thread
+    void post(std::function<void()> callback) {
+        {
+            std::lock_guard<std::mutex> lock(postedMutex);
+            posted.push_back(std::move(callback));
+        }
+        uint64_t one = 1;
+        ssize_t written = write(wakeFd, &one, sizeof(one));
+        (void)written;
+    }
+
+    // Run callback on the loop thread every interval until the loop exits
+    void every(Clock::duration interval, std::function<void()> callback) {
+        auto shared = std::make_shared<std::function<void()>>(std::move(callback));
+        scheduleRepeating(interval, shared);
+    }
+
+    // Awaitable that completes with the next line of terminal input
+    auto readLine(InputKind kind = InputKind::Line) {
+        struct LineAwaiter {
+            EventLoop& loop;
+            InputKind kind;
+            SuspendedAllocations allocations{};
+            bool await_ready() const { return loop.replaying || !loop.lines.empty() || loop.inputClosed; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                allocations.suspend();
+                loop.lineWaiter = handle;
+            }
+            std::string await_resume() {
+                allocations.resume();
+                return loop.takeLine(kind);
+            }
+        };
+        std::cout << std::flush;
+        return LineAwaiter{*this, kind};
+    }
+
+    // Append every line read from now on to out as "<ms>\t<kind>\t<line>"
+    void recordTo(std::ostream& out) {
+        recorder = &out;
+        recordingStarted = Clock::now();
+    }
+
+    // Serve input from a recording instead of the terminal
+    void replayFrom(std::deque<InputRecord> records) {
+        lines = std::move(records);
+        replaying = true;
+        inputClosed = true;
+        if (inputPollable) epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+    }
+
+    bool isReplaying() const { return replaying; }
+
+    static const char* kindName(InputKind kind) { return kind == InputKind::Pause ? "pause" : "line"; }
+
+    // Awaitable that resumes the coroutine after the given delay
+    auto sleepFor(Clock::duration delay) {
+        struct SleepAwaiter {
+            EventLoop& loop;
+            Clock::time_point deadline;
+            SuspendedAllocations allocations{};
+            bool await_ready() const { return deadline <= Clock::now(); }
+            void await_suspend(std::coroutine_handle<> handle) {
+                allocations.suspend();
+                loop.timers.emplace(deadline, [handle] { handle.resume(); });
+            }
+            void await_resume() { allocations.resume(); }
+        };
+        return SleepAwaiter{*this, Clock::now() + delay};
+    }
+
+    /*
+     * Awaitable that runs function on the thread pool and resumes the
+     * coroutine on the loop thread with its result, leaving the loop free to
+     * serve input and timers meanwhile.
+     */
+    template<typename Function>
+    auto runInBackground(ThreadPool& pool, Function function,
+                         TaskPriority priority = TaskPriority::Interactive) {
+        using Result = decltype(function());
+        struct BackgroundAwaiter {
+            EventLoop& loop;
+            ThreadPool& pool;
+            Function function;
+            TaskPriority priority;
+            std::conditional_t<std::is_void_v<Result>, bool, std::optional<Result>> result{};
+            std::exception_ptr error;
+            SuspendedAllocations allocations{};
+
+            bool await_ready() const { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                pool.submit([this, handle] {
+                    try {
+                        if constexpr (std::is_void_v<Result>) {
+                            function();
+                        } else {
+                            result = function();
+                        }
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    loop.post([handle] { handle.resume(); });
+                }, priority);
+                allocations.suspend();      // After submit, which hands the counter to the task
+            }
+            Result await_resume() {
+                allocations.resume();
+                if (error) std::rethrow_exception(error);
+                if constexpr (!std::is_void_v<Result>) return std::move(*result);
+            }
+        };
+        return BackgroundAwaiter{*this, pool, std::move(function), priority, {}, {}};
+    }
+
+private:
+    int epollFd = -1;
+    int wakeFd = -1;
+    bool inputPollable = false;
+    bool inputClosed = false;
+    bool replaying = false;
+    std::string inputBuffer;
+    std::deque<InputRecord> lines;
+    std::ostream* recorder = nullptr;
+    Clock::time_point recordingStarted;
+    std::coroutine_handle<> lineWaiter;
+    std::multimap<Clock::time_point, std::function<void()>> timers;
+    std::mutex postedMutex;
+    std::vector<std::function<void()>> posted;
+
+    bool addWatch(int fd) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void scheduleRepeating(Clock::duration interval, std::shared_ptr<std::function<void()>> callback) {
+        timers.emplace(Clock::now() + interval, [this, interval, callback] {
+            {
+                AllocationScope scope(nullptr);     // Periodic work belongs to no operation
+                (*callback)();
+            }
+            scheduleRepeating(interval, callback);
+        });
+    }
+
+    int nextTimeoutMs() const {
+        if (timers.empty()) return -1;
+        auto wait = timers.begin()->first - Clock::now();
+        if (wait <= Clock::duration::zero()) return 0;
+        return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+    }
+
+    void runPosted() {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(postedMutex);
+            ready.swap(posted);
+        }
+        for (auto& callback : ready) callback();
+    }
+
+    void runDueTimers() {
+        auto now = Clock::now();
+        while (!timers.empty() && timers.begin()->first <= now) {
+            auto callback = std::move(timers.begin()->second);
+            timers.erase(timers.begin());
+            callback();
+        }
+    }
+
+    // Next queued line for a reader of the given kind, recorded if enabled
+    std::string takeLine(InputKind kind) {
+        if (replaying) {
+            while (!lines.empty() && lines.front().kind == InputKind::Pause) lines.pop_front();
+            if (kind == InputKind::Pause) return "";
+        }
+        if (lines.empty()) throw InputClosedError();
+        std::string line = std::move(lines.front().text);
+        lines.pop_front();
+        if (recorder) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - recordingStarted);
+            *recorder << elapsed.count() << '\t' << kindName(kind) << '\t' << line << std::endl;
+        }
+        return line;
+    }
+
+    // Read available terminal input, split it into lines and wake the reader
+    void readInput() {
+        char buffer[4096];
+        ssize_t count = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) return;
+        if (count <= 0) {
+            inputClosed = true;
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+            if (!inputBuffer.empty()) lines.push_back({0, InputKind::Line, std::move(inputBuffer)});
+            inputBuffer.clear();
+        } else {
+            inputBuffer.append(buffer, static_cast<size_t>(count));
+            size_t newline;
+            while ((newline = inputBuffer.find('\n')) != std::string::npos) {
+                lines.push_back({0, InputKind::Line, inputBuffer.substr(0, newline)});
+                inputBuffer.erase(0, newline + 1);
+            }
+        }
+        if (lineWaiter && (!lines.empty() || inputClosed)) {
+            std::exchange(lineWaiter, nullptr).resume();
+        }
+    }
+};
+
+// Reasons a field fails validation; None when it is valid
+enum class ValidationError : uint8_t {
+    None,
+    NameLength,
+    NameFormat,
+    PhoneFormat,
+    EmailFormat,
+    AddressLength,
+    BirthdateFormat,
+};
+
+// Error messages class for centralized message management
+class ErrorMessages {
+public:
+    static std::string nameLength(size_t maxLength) {
+        return "Name must be between 2 and " + 
+               std::to_string(maxLength) + " characters.";
+    }
+    
+    static std::string nameFormat() {
+        return "Name must contain only letters and spaces.";
+    }
+    
+    static std::string phoneFormat() {
+        return "Phone number must be 11 digits starting with '09' (e.g., 09244561530)";
+    }
+    
+    static std::string emailFormat(size_t maxLength) {
+        return "Invalid email format (at most " + std::to_string(maxLength) +
+               " characters). Example: user@domain.com";
+    }
+    
+    static std::string birthdateFormat() {
+        return "Birthdate must be in format: DD/MM/YYYY";
+    }
+    
+    static std::string addressLength(size_t maxLength) {
+        return "Address must be between 5 and " + 
+               std::to_string(maxLength) + " characters.";
+    }
+
+    // Message for a validation error, built only when it is shown
+    static std::string forError(ValidationError error, size_t maxLength) {
+        switch (error) {
+            case ValidationError::None: return "";
+            case ValidationError::NameLength: return nameLength(maxLength);
+            case ValidationError::NameFormat: return nameFormat();
+            case ValidationError::PhoneFormat: return phoneFormat();
+            case ValidationError::EmailFormat: return emailFormat(maxLength);
+            case ValidationError::AddressLength: return addressLength(maxLength);
+            case ValidationError::BirthdateFormat: return birthdateFormat();
+        }
+        return "";
+    }
+};
+
+/*
+ * Input validation class. The check functions return a ValidationError
+ * and never allocate, so whole files of records can be validated cheaply.
+ */
+class InputValidator {
+public:
+    static constexpr size_t MAX_TEXT_LENGTH = 100;
+    static constexpr size_t MIN_NAME_LENGTH = 2;
+    static constexpr size_t MIN_ADDRESS_LENGTH = 5;
+
+    // Name: letters and spaces only
+    static ValidationError checkName(std::string_view name) {
+        if (name.length() < MIN_NAME_LENGTH || name.length() > MAX_TEXT_LENGTH) return ValidationError::NameLength;
+        bool letters = std::all_of(name.begin(), name.end(), [](char c) {
+            return std::isalpha(static_cast<unsigned char>(c)) || std::isspace(static_cast<unsigned char>(c));
+        });
+        return letters ? ValidationError::None : ValidationError::NameFormat;
+    }
+
+    // Phone number: exactly 11 digits starting with '09' (Philippine format)
+    static ValidationError checkPhoneNumber(std::string_view phone) {
+        if (phone.length() != 11 || phone.substr(0, 2) != "09" || !allDigits(phone)) return ValidationError::PhoneFormat;
+        return ValidationError::None;
+    }
+
+    // Email: local@domain.tld, where the local part uses letters, digits and
+    // ._%+-, the domain letters, digits and .- and the last label is at
+    // least two letters
+    static ValidationError checkEmail(std::string_view email) {
+        if (email.length() > MAX_TEXT_LENGTH) return ValidationError::EmailFormat;
+        size_t at = email.find('@');
+        if (at == 0 || at == std::string_view::npos) return ValidationError::EmailFormat;
+        std::string_view local = email.substr(0, at), domain = email.substr(at + 1);
+        auto alnum = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) != 0; };
+        bool localOk = std::all_of(local.begin(), local.end(), [&](char c) {
+            return alnum(c) || c == '.' || c == '_' || c == '%' || c == '+' || c == '-';
+        });
+        bool domainOk = std::all_of(domain.begin(), domain.end(), [&](char c) { return alnum(c) || c == '.' || c == '-'; });
+        size_t dot = domain.rfind('.');
+        if (!localOk || !domainOk || dot == 0 || dot == std::string_view::npos || domain.size() - dot - 1 < 2) {
+            return ValidationError::EmailFormat;
+        }
+        bool tldOk = std::all_of(domain.begin() + dot + 1, domain.end(),
+                                 [](char c) { return std::isalpha(static_cast<unsigned char>(c)) != 0; });
+        return tldOk ? ValidationError::None : ValidationError::EmailFormat;
+    }
+
+    // Birthdate: DD/MM/YYYY with a plausible day, month and year
+    static ValidationError checkBirthdate(std::string_view date) {
+        if (date.length() != 10 || date[2] != '/' || date[5] != '/' || !allDigits(date.substr(0, 2)) ||
+            !allDigits(date.substr(3, 2)) || !allDigits(date.substr(6, 4))) {
+            return ValidationError::BirthdateFormat;
+        }
+        int day = (date[0] - '0') * 10 + (date[1] - '0');
+        int month = (date[3] - '0') * 10 + (date[4] - '0');
+        int year = (date[6] - '0') * 1000 + (date[7] - '0') * 100 + (date[8] - '0') * 10 + (date[9] - '0');
+        if (month < 1 || month > 12 || day < 1 || day > 31 || year < 1900 || year > 2025) {
+            return ValidationError::BirthdateFormat;
+        }
+        return ValidationError::None;
+    }
+
+    static ValidationError checkAddress(std::string_view address) {
+        if (address.length() < MIN_ADDRESS_LENGTH || address.length() > MAX_TEXT_LENGTH) return ValidationError::AddressLength;
+        return ValidationError::None;
+    }
+
+    // First error among the fields of contact, in field order
+    static ValidationError check(const Contact& contact) {
+        for (ValidationError error : {checkName(contact.getName()), checkPhoneNumber(contact.getPhoneNumber()),
+                                      checkEmail(contact.getEmail()), checkAddress(contact.getAddress()),
+                                      checkBirthdate(contact.getBirthdate())}) {
+            if (error != ValidationError::None) return error;
+        }
+        return ValidationError::None;
+    }
+
+    // Format phone number for display (convert 09XXXXXXXXX to +63 (XXX) XXX XXXX)
+    static std::string formatPhoneNumber(const std::string& phone) {
+        if (phone.length() != 11 || phone.substr(0, 2) != "09") return phone;
+        
+        std::string areaCode = phone.substr(1, 3);
+        std::string firstPart = phone.substr(4, 3);
+        std::string secondPart = phone.substr(7, 4);
+        
+        return "+63 (" + areaCode + ") " + firstPart + " " + secondPart;
+    }
+
+    /*
+     * Prompts until check accepts the input; the error message is built
+     * only when an input is rejected. With a current value the prompt reads
+     * "prompt [current]: " and an empty answer (returned as is) keeps it.
+     */
+    template<typename Checker>
+    static Task<std::string> getValidInput(
+        EventLoop& loop,
+        std::string_view prompt,
+        Checker check,
+        const std::string* current = nullptr
+    ) {
+        std::string input;
+        while (true) {
+            std::cout << prompt;
+            if (current) std::cout << " [" << *current << "]: ";
+            input = co_await loop.readLine();
+            if (current && input.empty()) break;
+            ValidationError error = check(input);
+            if (error == ValidationError::None) break;
+            std::cout << "\nError: " << ErrorMessages::forError(error, MAX_TEXT_LENGTH) << "\n\n";
+        }
+        co_return input;
+    }
+
+private:
+    static bool allDigits(std::string_view text) {
+        return std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+};
+
+/*
+ * EpochManager Class: Epoch-based reclamation for RCU-style published data.
+ *
+ * Readers announce the global epoch in a reader slot for the duration of a
+ * read and never block. Writers retire replaced versions tagged with
+ * the epoch at which they were unlinked; a retired version is freed once
+ * every active reader has announced a later epoch.
+ */
+class EpochManager {
+public:
+    static constexpr size_t READER_SLOTS = 128;
+    static constexpr uint64_t INACTIVE = 0;
+
+    // RAII read-side critical section
+    class ReadGuard {
+    private:
+        std::atomic<uint64_t>* slot;
+
+    public:
+        explicit ReadGuard(EpochManager& manager) : slot(&manager.claimSlot()) {}
+        ~ReadGuard() { slot->store(INACTIVE); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    ~EpochManager() {
+        for (auto& retired : retiredList) retired.destroy();
+    }
+
+    // Hand over an unlinked object; it is deleted once no reader can see it
+    template<typename T>
+    void retire(const T* object) {
+        uint64_t epoch = globalEpoch.fetch_add(1);
+        std::lock_guard<std::mutex> lock(retireMutex);
+        retiredList.push_back({epoch, object, [](const void* p) { delete static_cast<const T*>(p); }});
+        reclaimLocked();
+    }
+
+    size_t pendingReclamation() const {
+        std::lock_guard<std::mutex> lock(retireMutex);
+        return retiredList.size();
+    }
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        const void* object;
+        void (*deleter)(const void*);
+        void destroy() { deleter(object); }
+    };
+
+    std::atomic<uint64_t> globalEpoch{1};
+    std::atomic<uint64_t> slots[READER_SLOTS] = {};   // INACTIVE when free
+    mutable std::mutex retireMutex;
+    std::vector<Retired> retiredList;
+
+    /*
+     * Announce the current epoch in a free slot. Slots are claimed per read
+     * rather than per thread, so threads may come and go freely; each thread
+     * starts probing at the slot it used last.
+     */
+    std::atomic<uint64_t>& claimSlot() {
+        static thread_local size_t hint =
+            std::hash<std::thread::id>()(std::this_thread::get_id()) % READER_SLOTS;
+        uint64_t epoch = globalEpoch.load();
+        for (size_t i = hint;; i = (i + 1) % READER_SLOTS) {
+            uint64_t expected = INACTIVE;
+            if (slots[i].compare_exchange_strong(expected, epoch)) {
+                hint = i;
+                return slots[i];
+            }
+        }
+    }
+
+    void reclaimLocked() {
+        uint64_t oldestActive = UINT64_MAX;
+        for (const auto& slot : slots) {
+            uint64_t epoch = slot.load();
+            if (epoch != INACTIVE) oldestActive = std::min(oldestActive, epoch);
+        }
+
+        auto firstKept = std::partition(retiredList.begin(), retiredList.end(),
+            [oldestActive](const Retired& retired) { return retired.epoch < oldestActive; });
+        for (auto it = retiredList.begin(); it != firstKept; ++it) it->destroy();
+        retiredList.erase(retiredList.begin(), firstKept);
+    }
+};
+
+/*
+ * ContactIndex Class: Name and phone lookup indexes with a lock-free read
+ * path. Each published version is immutable; writers stage changes and
+ * publish() swaps in a new version containing the whole batch. Both maps
+ * are split by key hash into shards shared between versions, so a publish
+ * copies only the shards its changes touch.
+ */
+class ContactIndex {
+public:
+    using IdList = std::vector<uint64_t>;   // Ascending, i.e. in insertion order
+    using Shard = std::unordered_map<std::string, IdList>;
+    using ShardPtr = std::shared_ptr<const Shard>;
+    static constexpr size_t SHARDS = 4096;  // Per map; a 1M contact book has about 250 keys per shard
+
+    struct Version {
+        std::array<ShardPtr, SHARDS> byName;
+        std::array<ShardPtr, SHARDS> byPhone;
+        size_t nameCount = 0;               // Distinct keys over all shards
+        size_t phoneCount = 0;
+
+        Version() {
+            auto empty = std::make_shared<const Shard>();
+            byName.fill(empty);
+            byPhone.fill(empty);
+        }
+    };
+
+    ContactIndex() : current(new Version()) {}
+
+    ~ContactIndex() { delete current.load(); }
+
+    ContactIndex(const ContactIndex&) = delete;
+    ContactIndex& operator=(const ContactIndex&) = delete;
+
+    // Lock-free lookups; safe from any thread
+    IdList findByName(const std::string& name) const { return lookup(&Version::byName, name); }
+    IdList findByPhone(const std::string& phone) const { return lookup(&Version::byPhone, phone); }
+
+    size_t distinctNames() const {
+        EpochManager::ReadGuard guard(epochs);
+        return current.load()->nameCount;
+    }
+
+    size_t distinctPhones() const {
+        EpochManager::ReadGuard guard(epochs);
+        return current.load()->phoneCount;
+    }
+
+    // Approximate bytes of the published version
+    size_t memoryBytes() const {
+        EpochManager::ReadGuard guard(epochs);
+        const Version* version = current.load();
+        auto idBytes = [](const IdList& ids) { return ids.capacity() * sizeof(uint64_t); };
+        size_t bytes = sizeof(Version);
+        for (size_t shard = 0; shard < SHARDS; ++shard) {
+            bytes += hashMapBytes(*version->byName[shard], idBytes) + hashMapBytes(*version->byPhone[shard], idBytes);
+        }
+        return bytes;
+    }
+
+    // Writer side (single writer): stage changes, then publish them together
+    void stageInsert(const Contact& contact) {
+        pending.push_back({true, contact.getId(), contact.getName(), contact.getPhoneNumber()});
+    }
+
+    void stageRemove(const Contact& contact) {
+        pending.push_back({false, contact.getId(), contact.getName(), contact.getPhoneNumber()});
+    }
+
+    void stageClear() {
+        pending.clear();
+        clearPending = true;
+    }
+
+    void publish() {
+        if (pending.empty() && !clearPending) return;
+        const Version* old = current.load();
+        Version* next = clearPending ? new Version() : new Version(*old);
+
+        // Copy each touched shard once, then apply the batch to the copies
+        std::array<Shard*, SHARDS> names{}, phones{};
+        auto writable = [](std::array<ShardPtr, SHARDS>& shards, std::array<Shard*, SHARDS>& copies,
+                           const std::string& key) -> Shard& {
+            size_t shard = shardOf(key);
+            if (!copies[shard]) {
+                auto copy = std::make_shared<Shard>(*shards[shard]);
+                copies[shard] = copy.get();
+                shards[shard] = std::move(copy);
+            }
+            return *copies[shard];
+        };
+        for (const auto& change : pending) {
+            Shard& nameShard = writable(next->byName, names, change.name);
+            size_t nameKeys = nameShard.size();
+            apply(nameShard, change.name, change);
+            next->nameCount += nameShard.size() - nameKeys;
+
+            Shard& phoneShard = writable(next->byPhone, phones, change.phone);
+            size_t phoneKeys = phoneShard.size();
+            apply(phoneShard, change.phone, change);
+            next->phoneCount += phoneShard.size() - phoneKeys;
+        }
+        pending.clear();
+        clearPending = false;
+        current.store(next);
+        epochs.retire(old);
+    }
+
+private:
+    struct Change {
+        bool insert;
+        uint64_t id;
+        std::string name;
+        std::string phone;
+    };
+
+    std::atomic<const Version*> current;
+    mutable EpochManager epochs;
+    std::vector<Change> pending;
+    bool clearPending = false;
+
+    static size_t shardOf(const std::string& key) { return std::hash<std::string>()(key) % SHARDS; }
+
+    IdList lookup(std::array<ShardPtr, SHARDS> Version::*map, const std::string& key) const {
+        EpochManager::ReadGuard guard(epochs);
+        const Shard& shard = *(current.load()->*map)[shardOf(key)];
+        auto it = shard.find(key);
+        return it == shard.end() ? IdList() : it->second;
+    }
+
+    static void apply(Shard& map, const std::string& key, const Change& change) {
+        IdList& ids = map[key];
+        auto position = std::lower_bound(ids.begin(), ids.end(), change.id);
+        if (change.insert) {
+            if (position == ids.end() || *position != change.id) ids.insert(position, change.id);
+        } else if (position != ids.end() && *position == change.id) {
+            ids.erase(position);
+        }
+        if (ids.empty()) map.erase(key);
+    }
+};
+
+/*
+ * ContactObserver Interface: Notified after every committed change to the
+ * contact list, so derived structures can be maintained incrementally
+ */
+class ContactObserver {
+public:
+    virtual ~ContactObserver() = default;
+    virtual void onContactAdded(const Contact& contact) = 0;
+    virtual void onContactRemoved(const Contact& contact) = 0;
+    virtual void onContactsReloaded(const std::vector<Contact>& contacts) = 0;
+
+    // By default a modification is a removal followed by an insertion
+    virtual void onContactModified(const Contact& before, const Contact& after) {
+        onContactRemoved(before);
+        onContactAdded(after);
+    }
+};
+
+/*
+ * HierarchicalTimerWheel Class: Timers keyed by id with O(1) insert and
+ * remove. Level 0 has one slot per tick; each higher level covers 64 times
+ * the span of the level below, and its timers cascade down one level as
+ * time reaches their slot. Four levels of 64 slots span 2^24 ticks.
+ */
+class HierarchicalTimerWheel {
+public:
+    static constexpr unsigned BITS_PER_LEVEL = 6;
+    static constexpr size_t SLOTS_PER_LEVEL = size_t(1) << BITS_PER_LEVEL;
+    static constexpr size_t LEVELS = 4;
+    static constexpr uint64_t SLOT_MASK = SLOTS_PER_LEVEL - 1;
+
+    explicit HierarchicalTimerWheel(uint64_t startTick = 0) : currentTick(startTick) {}
+
+    uint64_t now() const { return currentTick; }
+    size_t size() const { return timers.size(); }
+
+    // Schedule (or reschedule) timer id; past expiries fire on the next tick
+    void schedule(uint64_t id, uint64_t expiryTick) {
+        cancel(id);
+        expiryTick = std::max(expiryTick, currentTick + 1);
+        place(id, expiryTick);
+    }
+
+    void cancel(uint64_t id) {
+        auto it = timers.find(id);
+        if (it == timers.end()) return;
+        wheel[it->second.level][it->second.slot].erase(it->second.position);
+        timers.erase(it);
+    }
+
+    void clear() {
+        timers.clear();
+        for (auto& level : wheel) {
+            for (auto& slot : level) slot.clear();
+        }
+    }
+
+    // Advance to targetTick, calling fire(id, expiryTick) for each due timer
+    template<typename Fire>
+    void advanceTo(uint64_t targetTick, Fire fire) {
+        while (currentTick < targetTick) {
+            ++currentTick;
+            cascade();
+            auto& due = wheel[0][currentTick & SLOT_MASK];
+            while (!due.empty()) {
+                uint64_t id = due.front();
+                due.pop_front();
+                timers.erase(id);
+                fire(id, currentTick);
+            }
+        }
+    }
+
+private:
+    struct Timer {
+        uint64_t expiry;
+        size_t level;
+        size_t slot;
+        std::list<uint64_t>::iterator position;
+    };
+
+    uint64_t currentTick;
+    std::list<uint64_t> wheel[LEVELS][SLOTS_PER_LEVEL];
+    std::unordered_map<uint64_t, Timer> timers;
+
+    // The level is the highest 6-bit digit in which expiry and now differ
+    void place(uint64_t id, uint64_t expiryTick) {
+        size_t level = 0;
+        while (level + 1 < LEVELS &&
+               (expiryTick >> (BITS_PER_LEVEL * (level + 1))) != (currentTick >> (BITS_PER_LEVEL * (level + 1)))) {
+            ++level;
+        }
+        size_t slot = (expiryTick >> (BITS_PER_LEVEL * level)) & SLOT_MASK;
+        auto& list = wheel[level][slot];
+        list.push_back(id);
+        timers[id] = {expiryTick, level, slot, std::prev(list.end())};
+    }
+
+    // When a lower level wraps, pull the matching higher-level slot down
+    void cascade() {
+        size_t top = 0;
+        while (top + 1 < LEVELS && ((currentTick >> (BITS_PER_LEVEL * (top + 1))) << (BITS_PER_LEVEL * (top + 1))) == currentTick) {
+            ++top;
+        }
+        for (size_t level = top; level >= 1; --level) {
+            auto& slot = wheel[level][(currentTick >> (BITS_PER_LEVEL * level)) & SLOT_MASK];
+            std::list<uint64_t> moving;
+            moving.swap(slot);
+            for (uint64_t id : moving) {
+                uint64_t expiry = timers[id].expiry;
+                place(id, expiry);
+            }
+        }
+    }
+};
+
+/*
+ * BirthdayScheduler Class: Keeps one timer per contact on a timer wheel,
+ * set to the contact's next birthday, and appends a reminder to a spool
+ * file (and calls an optional callback) when it fires. Ticks are minutes.
+ */
+class BirthdayScheduler : public ContactObserver {
+public:
+    using Callback = std::function<void(const std::string& message)>;
+
+    static constexpr int REMINDER_HOUR = 9;     // Local time reminders fire at
+
+    explicit BirthdayScheduler(const std::string& spoolPath = "birthday_reminders.txt")
+        : spoolPath(spoolPath), wheel(currentMinute()) {}
+
+    void setCallback(Callback callback) { this->callback = std::move(callback); }
+    size_t scheduledCount() const { return wheel.size(); }
+
+    // Fire every reminder that has come due; call periodically
+    void poll() {
+        wheel.advanceTo(currentMinute(), [this](uint64_t id, uint64_t) { fire(id); });
+    }
+
+    void onContactAdded(const Contact& contact) override {
+        people[contact.getId()] = {contact.getName(), contact.getBirthdate()};
+        scheduleNext(contact.getId());
+    }
+
+    void onContactRemoved(const Contact& contact) override {
+        people.erase(contact.getId());
+        wheel.cancel(contact.getId());
+    }
+
+    void onContactModified(const Contact& before, const Contact& after) override {
+        if (before.getName() == after.getName() && before.getBirthdate() == after.getBirthdate()) return;
+        onContactRemoved(before);
+        onContactAdded(after);
+    }
+
+    void onContactsReloaded(const std::vector<Contact>& contacts) override {
+        people.clear();
+        wheel.clear();
+        for (const auto& contact : contacts) onContactAdded(contact);
+    }
+
+private:
+    struct Person {
+        std::string name;
+        std::string birthdate;  // DD/MM/YYYY
+    };
+
+    std::string spoolPath;
+    HierarchicalTimerWheel wheel;
+    std::unordered_map<uint64_t, Person> people;
+    std::array<uint64_t, 12 * 31> nextMinuteByDate{};
+    Callback callback;
+
+    static uint64_t currentMinute() {
+        return static_cast<uint64_t>(std::time(nullptr)) / 60;
+    }
+
+    // Minute of the next REMINDER_HOUR on the birthday, or 0 if unparsable
+    static uint64_t nextBirthdayMinute(const std::string& birthdate, std::time_t now) {
+        if (birthdate.size() != 10) return 0;
+        int day = std::atoi(birthdate.substr(0, 2).c_str());
+        int month = std::atoi(birthdate.substr(3, 2).c_str());
+        if (day < 1 || day > 31 || month < 1 || month > 12) return 0;
+
+        std::tm local = *std::localtime(&now);
+        for (int yearOffset = 0; yearOffset <= 1; ++yearOffset) {
+            std::tm candidate{};
+            candidate.tm_year = local.tm_year + yearOffset;
+            candidate.tm_mon = month - 1;
+            candidate.tm_mday = day;      // 29/02 rolls over to 01/03 in common years
+            candidate.tm_hour = REMINDER_HOUR;
+            candidate.tm_isdst = -1;
+            std::time_t when = std::mktime(&candidate);
+            if (when > now) return static_cast<uint64_t>(when) / 60;
+        }
+        return 0;
+    }
+
+    /*
+     * mktime() is slow, but the next occurrence only depends on day and
+     * month and stays valid until it passes, so it is cached per date.
+     */
+    void scheduleNext(uint64_t id) {
+        const std::string& birthdate = people[id].birthdate;
+        std::time_t now = std::time(nullptr);
+        uint64_t expiry = 0;
+        if (birthdate.size() == 10) {
+            int day = std::atoi(birthdate.substr(0, 2).c_str());
+            int month = std::atoi(birthdate.substr(3, 2).c_str());
+            if (day >= 1 && day <= 31 && month >= 1 && month <= 12) {
+                uint64_t& cached = nextMinuteByDate[(month - 1) * 31 + (day - 1)];
+                if (cached <= static_cast<uint64_t>(now) / 60) cached = nextBirthdayMinute(birthdate, now);
+                expiry = cached;
+            }
+        }
+        if (expiry != 0) wheel.schedule(id, expiry);
+    }
+
+    void fire(uint64_t id) {
+        auto it = people.find(id);
+        if (it == people.end()) return;
+
+        std::time_t now = std::time(nullptr);
+        std::tm local = *std::localtime(&now);
+        int age = local.tm_year + 1900 - std::atoi(it->second.birthdate.substr(6, 4).c_str());
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M", &local);
+        std::string message = std::string(stamp) + " Today is " + it->second.name +
+                              "'s birthday (turning " + std::to_string(age) + ")";
+
+        std::ofstream spool(spoolPath, std::ios::app);
+        if (spool) spool << message << '\n';
+        if (callback) callback(message);
+
+        scheduleNext(id);
+    }
+};
+
+/*
+ * ContactStatistics Class: Aggregate counts by birth month, phone prefix,
+ * city and email domain, maintained incrementally on every change
+ */
+class ContactStatistics : public ContactObserver {
+public:
+    using Counts = std::unordered_map<std::string, size_t>;
+
+    size_t total() const { return contactCount; }
+    const std::array<size_t, 12>& byBirthMonth() const { return monthCounts; }
+    const Counts& byPhonePrefix() const { return prefixCounts; }
+    const Counts& byCity() const { return cityCounts; }
+    const Counts& byEmailDomain() const { return domainCounts; }
+
+    // Largest entries of a count table, most frequent first
+    static std::vector<std::pair<std::string, size_t>> top(const Counts& counts, size_t limit) {
+        std::vector<std::pair<std::string, size_t>> entries(counts.begin(), counts.end());
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        if (entries.size() > limit) entries.resize(limit);
+        return entries;
+    }
+
+    static std::string phonePrefix(const std::string& phone) { return phone.substr(0, 4); }
+
+    static std::string emailDomain(const std::string& email) {
+        size_t at = email.rfind('@');
+        std::string domain = at == std::string::npos ? "" : email.substr(at + 1);
+        std::transform(domain.begin(), domain.end(), domain.begin(), ::tolower);
+        return domain;
+    }
+
+    // Recognized city, else the last comma-separated part of the address
+    static std::string city(const Contact& contact) {
+        if (!contact.getCity().empty()) return contact.getCity();
+        const std::string& address = contact.getAddress();
+        size_t comma = address.rfind(',');
+        std::string part = comma == std::string::npos ? address : address.substr(comma + 1);
+        size_t first = part.find_first_not_of(' ');
+        size_t last = part.find_last_not_of(' ');
+        return first == std::string::npos ? "" : part.substr(first, last - first + 1);
+    }
+
+    // Birth month 1-12, or 0 if the birthdate is malformed
+    static int birthMonth(const std::string& birthdate) {
+        if (birthdate.size() != 10) return 0;
+        int month = std::atoi(birthdate.substr(3, 2).c_str());
+        return month >= 1 && month <= 12 ? month : 0;
+    }
+
+    void onContactAdded(const Contact& contact) override { apply(contact, +1); }
+    void onContactRemoved(const Contact& contact) override { apply(contact, -1); }
+
+    void onContactsReloaded(const std::vector<Contact>& contacts) override {
+        contactCount = 0;
+        monthCounts.fill(0);
+        prefixCounts.clear();
+        cityCounts.clear();
+        domainCounts.clear();
+        for (const auto& contact : contacts) apply(contact, +1);
+    }
+
+private:
+    size_t contactCount = 0;
+    std::array<size_t, 12> monthCounts{};
+    Counts prefixCounts;
+    Counts cityCounts;
+    Counts domainCounts;
+
+    static void adjust(Counts& counts, const std::string& key, int delta) {
+        if (delta > 0) {
+            ++counts[key];
+        } else {
+            auto it = counts.find(key);
+            if (it != counts.end() && --it->second == 0) counts.erase(it);
+        }
+    }
+
+    void apply(const Contact& contact, int delta) {
+        contactCount += delta;
+        int month = birthMonth(contact.getBirthdate());
+        if (month != 0) monthCounts[month - 1] += delta;
+        adjust(prefixCounts, phonePrefix(contact.getPhoneNumber()), delta);
+        adjust(cityCounts, city(contact), delta);
+        adjust(domainCounts, emailDomain(contact.getEmail()), delta);
+    }
+};
+
+/*
+ * Sketch hashing: 64-bit FNV-1a with a splitmix64 finalizer. Stable across
+ * runs and machines, so sketches built from different files can be merged.
+ */
+inline uint64_t sketchHash(const std::string& key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/*
+ * HyperLogLog Class: Approximate distinct count in 2^PRECISION bytes
+ * (about 0.8% standard error at precision 14)
+ */
+class HyperLogLog {
+public:
+    static constexpr unsigned PRECISION = 14;
+    static constexpr size_t REGISTER_COUNT = size_t(1) << PRECISION;
+
+    HyperLogLog() : registers(REGISTER_COUNT, 0) {}
+
+    void add(const std::string& key) {
+        uint64_t hash = sketchHash(key);
+        size_t index = hash >> (64 - PRECISION);
+        uint64_t rest = (hash << PRECISION) | (uint64_t(1) << (PRECISION - 1));
+        uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < REGISTER_COUNT; ++i) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    double estimate() const {
+        const double m = static_cast<double>(REGISTER_COUNT);
+        double sum = 0.0;
+        size_t zeros = 0;
+        for (uint8_t value : registers) {
+            sum += std::ldexp(1.0, -value);
+            if (value == 0) ++zeros;
+        }
+        double raw = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+        // Linear counting is more accurate while many registers are empty
+        if (raw <= 2.5 * m && zeros != 0) return m * std::log(m / zeros);
+        return raw;
+    }
+
+private:
+    std::vector<uint8_t> registers;
+};
+
+/*
+ * CountMinSketch Class: Approximate per-key frequencies; estimates never
+ * undercount and overcount by at most e/WIDTH of the total with
+ * probability 1 - e^-DEPTH
+ */
+class CountMinSketch {
+public:
+    static constexpr size_t WIDTH = 2048;
+    static constexpr size_t DEPTH = 4;
+
+    CountMinSketch() : counters(WIDTH * DEPTH, 0) {}
+
+    void add(const std::string& key, uint32_t count = 1) {
+        uint64_t hash = sketchHash(key);
+        for (size_t row = 0; row < DEPTH; ++row) {
+            counters[row * WIDTH + column(hash, row)] += count;
+        }
+    }
+
+    uint32_t estimate(const std::string& key) const {
+        uint64_t hash = sketchHash(key);
+        uint32_t best = UINT32_MAX;
+        for (size_t row = 0; row < DEPTH; ++row) {
+            best = std::min(best, counters[row * WIDTH + column(hash, row)]);
+        }
+        return best;
+    }
+
+    void merge(const CountMinSketch& other) {
+        for (size_t i = 0; i < counters.size(); ++i) counters[i] += other.counters[i];
+    }
+
+private:
+    std::vector<uint32_t> counters;
+
+    // Row hashes derived from one 64-bit hash (Kirsch-Mitzenmacher)
+    static size_t column(uint64_t hash, size_t row) {
+        uint32_t low = static_cast<uint32_t>(hash);
+        uint32_t high = static_cast<uint32_t>(hash >> 32);
+        return (low + row * high) % WIDTH;
+    }
+};
+
+/*
+ * SpaceSaving Class: Tracks the CAPACITY most frequent keys of a stream.
+ * Any key occurring more than total/CAPACITY times is guaranteed present;
+ * each count overestimates by at most its recorded error.
+ */
+class SpaceSaving {
+public:
+    static constexpr size_t CAPACITY = 64;
+
+    struct Entry {
+        std::string key;
+        uint64_t count;
+        uint64_t error;
+    };
+
+    void add(const std::string& key, uint64_t count = 1) {
+        auto it = counters.find(key);
+        if (it != counters.end()) {
+            it->second.count += count;
+            return;
+        }
+        if (counters.size() < CAPACITY) {
+            counters[key] = {count, 0};
+            return;
+        }
+        // Replace the smallest counter, inheriting its count as error
+        auto smallest = std::min_element(counters.begin(), counters.end(),
+            [](const auto& a, const auto& b) { return a.second.count < b.second.count; });
+        uint64_t floor = smallest->second.count;
+        counters.erase(smallest);
+        counters[key] = {floor + count, floor};
+    }
+
+    // Combine counts of both summaries and keep the CAPACITY largest
+    void merge(const SpaceSaving& other) {
+        for (const auto& [key, counter] : other.counters) {
+            auto& mine = counters[key];
+            mine.count += counter.count;
+            mine.error += counter.error;
+        }
+        if (counters.size() > CAPACITY) {
+            std::vector<Entry> entries = top(counters.size());
+            counters.clear();
+            for (size_t i = 0; i < CAPACITY; ++i) {
+                counters[entries[i].key] = {entries[i].count, entries[i].error};
+            }
+        }
+    }
+
+    std::vector<Entry> top(size_t limit) const {
+        std::vector<Entry> entries;
+        for (const auto& [key, counter] : counters) entries.push_back({key, counter.count, counter.error});
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return a.count != b.count ? a.count > b.count : a.key < b.key;
+        });
+        if (entries.size() > limit) entries.resize(limit);
+        return entries;
+    }
+
+private:
+    struct Counter {
+        uint64_t count = 0;
+        uint64_t error = 0;
+    };
+
+    std::unordered_map<std::string, Counter> counters;
+};
+
+/*
+ * ImportSketches Class: Streaming statistics gathered while loading. Each
+ * load worker fills its own instance; instances from workers or from
+ * separate files are combined with merge().
+ */
+class ImportSketches {
+public:
+    void add(const Contact& contact) {
+        ++records;
+        distinctPhones.add(contact.getPhoneNumber());
+        distinctEmails.add(contact.getEmail());
+        std::string domain = ContactStatistics::emailDomain(contact.getEmail());
+        domainFrequencies.add(domain);
+        heavyDomains.add(domain);
+    }
+
+    void merge(const ImportSketches& other) {
+        records += other.records;
+        distinctPhones.merge(other.distinctPhones);
+        distinctEmails.merge(other.distinctEmails);
+        domainFrequencies.merge(other.domainFrequencies);
+        heavyDomains.merge(other.heavyDomains);
+    }
+
+    uint64_t recordCount() const { return records; }
+    double approximateDistinctPhones() const { return distinctPhones.estimate(); }
+    double approximateDistinctEmails() const { return distinctEmails.estimate(); }
+    uint32_t approximateDomainCount(const std::string& domain) const { return domainFrequencies.estimate(domain); }
+    std::vector<SpaceSaving::Entry> topDomains(size_t limit) const { return heavyDomains.top(limit); }
+
+private:
+    uint64_t records = 0;
+    HyperLogLog distinctPhones;
+    HyperLogLog distinctEmails;
+    CountMinSketch domainFrequencies;
+    SpaceSaving heavyDomains;
+};
+
+/*
+ * Query predicates: A filter such as
+ *     year=1990..2000 and prefix=0917 and not city="Cebu City"
+ * is parsed into a tree of QueryNode objects. Numeric fields are derived
+ * from the birthdate and phone number; city and province are the locality
+ * recognized from the address. Text comparisons are case-insensitive.
+ * A numeric field whose source is malformed has no value and satisfies no
+ * comparison on it, negated or not; the parser pushes "not" down to the
+ * comparisons so that this also holds under "not".
+ */
+enum class NumberField { Year, Month, Day, PhonePrefix };
+enum class TextField { Name, Phone, Email, Address, Birthdate, Domain, City, Province };
+enum class TextOp { Equals, NotEquals, Contains };
+
+// Numeric value of a derived field, or MISSING_NUMBER if the source field is malformed
+constexpr int32_t MISSING_NUMBER = -1;
+
+inline int32_t numberFieldValue(const Contact& contact, NumberField field) {
+    auto digits = [](const std::string& text, size_t pos, size_t length) -> int32_t {
+        if (text.size() < pos + length) return MISSING_NUMBER;
+        int32_t value = 0;
+        for (size_t i = pos; i < pos + length; ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(text[i]))) return MISSING_NUMBER;
+            value = value * 10 + (text[i] - '0');
+        }
+        return value;
+    };
+    switch (field) {
+        case NumberField::Year: return digits(contact.getBirthdate(), 6, 4);
+        case NumberField::Month: return digits(contact.getBirthdate(), 3, 2);
+        case NumberField::Day: return digits(contact.getBirthdate(), 0, 2);
+        case NumberField::PhonePrefix: return digits(contact.getPhoneNumber(), 0, 4);
+    }
+    return MISSING_NUMBER;
+}
+
+using NumberExtract = int32_t (*)(const Contact&);
+using TextTest = bool (*)(const Contact&, const std::string& upperValue);
+
+// Accessors instantiated per field, used by compiled and vectorized queries
+template<NumberField F>
+int32_t extractNumber(const Contact& contact) {
+    return numberFieldValue(contact, F);
+}
+
+template<TextField F>
+std::string_view textFieldView(const Contact& contact) {
+    if constexpr (F == TextField::Name) return contact.getName();
+    if constexpr (F == TextField::Phone) return contact.getPhoneNumber();
+    if constexpr (F == TextField::Email) return contact.getEmail();
+    if constexpr (F == TextField::Address) return contact.getAddress();
+    if constexpr (F == TextField::Birthdate) return contact.getBirthdate();
+    if constexpr (F == TextField::Domain) {
+        std::string_view email = contact.getEmail();
+        size_t at = email.rfind('@');
+        return at == std::string_view::npos ? std::string_view() : email.substr(at + 1);
+    }
+    if constexpr (F == TextField::City) return contact.getCity();
+    if constexpr (F == TextField::Province) return contact.getProvince();
+}
+
+inline bool equalsIgnoreCase(std::string_view text, std::string_view upper) {
+    if (text.size() != upper.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (std::toupper(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(upper[i])) return false;
+    }
+    return true;
+}
+
+inline bool containsIgnoreCase(std::string_view text, std::string_view upper) {
+    if (upper.size() > text.size()) return false;
+    for (size_t start = 0; start + upper.size() <= text.size(); ++start) {
+        if (equalsIgnoreCase(text.substr(start, upper.size()), upper)) return true;
+    }
+    return false;
+}
+
+template<TextField F, TextOp O>
+bool testText(const Contact& contact, const std::string& upperValue) {
+    std::string_view text = textFieldView<F>(contact);
+    if constexpr (O == TextOp::Equals) return equalsIgnoreCase(text, upperValue);
+    if constexpr (O == TextOp::NotEquals) return !equalsIgnoreCase(text, upperValue);
+    if constexpr (O == TextOp::Contains) return containsIgnoreCase(text, upperValue);
+}
+
+inline NumberExtract numberExtractFor(NumberField field) {
+    switch (field) {
+        case NumberField::Year: return &extractNumber<NumberField::Year>;
+        case NumberField::Month: return &extractNumber<NumberField::Month>;
+        case NumberField::Day: return &extractNumber<NumberField::Day>;
+        case NumberField::PhonePrefix: return &extractNumber<NumberField::PhonePrefix>;
+    }
+    return nullptr;
+}
+
+template<TextField F>
+TextTest textTestFor(TextOp op) {
+    switch (op) {
+        case TextOp::Equals: return &testText<F, TextOp::Equals>;
+        case TextOp::NotEquals: return &testText<F, TextOp::NotEquals>;
+        case TextOp::Contains: return &testText<F, TextOp::Contains>;
+    }
+    return nullptr;
+}
+
+inline TextTest textTestFor(TextField field, TextOp op) {
+    switch (field) {
+        case TextField::Name: return textTestFor<TextField::Name>(op);
+        case TextField::Phone: return textTestFor<TextField::Phone>(op);
+        case TextField::Email: return textTestFor<TextField::Email>(op);
+        case TextField::Address: return textTestFor<TextField::Address>(op);
+        case TextField::Birthdate: return textTestFor<TextField::Birthdate>(op);
+        case TextField::Domain: return textTestFor<TextField::Domain>(op);
+        case TextField::City: return textTestFor<TextField::City>(op);
+        case TextField::Province: return textTestFor<TextField::Province>(op);
+    }
+    return nullptr;
+}
+
+inline std::string upperCopy(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+    return text;
+}
+
+/*
+ * Gazetteer Class: Compact built-in list of Philippine cities and larger
+ * municipalities with their provinces, used to recognize the locality of
+ * free-form addresses such as "12 Rizal St, Brgy. Pajac, Lapu-Lapu City".
+ */
+class Gazetteer {
+public:
+    struct Locality {
+        const char* name;       // Display name, e.g. "Lapu-Lapu City"
+        const char* core;       // Name without "City", e.g. "Lapu-Lapu"
+        const char* province;
+    };
+
+    struct Recognized {
+        std::string city;       // Empty if no locality was recognized
+        std::string province;
+    };
+
+    // Upper-case words with punctuation removed, '-' split and 'ñ' folded
+    static std::vector<std::string> tokenize(const std::string& address) {
+        std::vector<std::string> tokens;
+        std::string current;
+        for (size_t i = 0; i < address.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(address[i]);
+            if (c == 0xC3 && i + 1 < address.size() &&
+                (static_cast<unsigned char>(address[i + 1]) == 0xB1 || static_cast<unsigned char>(address[i + 1]) == 0x91)) {
+                current.push_back('N');     // UTF-8 ñ / Ñ
+                ++i;
+            } else if (std::isalnum(c)) {
+                current.push_back(static_cast<char>(std::toupper(c)));
+            } else if (c != '.' && c != '\'' && !current.empty()) {
+                tokens.push_back(std::move(current));
+                current.clear();
+            }
+        }
+        if (!current.empty()) tokens.push_back(std::move(current));
+        return tokens;
+    }
+
+    /*
+     * Finds the city/municipality and province named in an address. The
+     * rightmost match wins; a name shared by several localities is resolved
+     * with the province when the address names one.
+     */
+    static Recognized recognize(const std::string& address) {
+        const Data& data = instance();
+        std::vector<std::string> tokens = tokenize(address);
+        Recognized result;
+
+        const Province* province = nullptr;
+        size_t provinceBegin = 0, provinceEnd = 0;
+        for (size_t end = tokens.size(); end > 0 && !province; --end) {
+            auto it = data.provincesByLast.find(tokens[end - 1]);
+            if (it == data.provincesByLast.end()) continue;
+            for (const Province* candidate : it->second) {
+                if (endsWith(tokens, end, candidate->tokens)) {
+                    province = candidate;
+                    provinceBegin = end - candidate->tokens.size();
+                    provinceEnd = end;
+                    break;
+                }
+            }
+        }
+
+        for (size_t end = tokens.size(); end > 0; --end) {
+            const std::vector<const Entry*>* matches = nullptr;
+            // "<core> CITY" ends one token later than a bare or "CITY OF <core>" name
+            bool citySuffix = tokens[end - 1] == "CITY" && end >= 2;
+            auto it = data.byLast.find(citySuffix ? tokens[end - 2] : tokens[end - 1]);
+            if (it == data.byLast.end()) continue;
+            for (const auto* entries : it->second) {
+                const Entry& entry = *entries->front();
+                size_t coreEnd = citySuffix ? end - 1 : end;
+                if (!endsWith(tokens, coreEnd, entry.tokens)) continue;
+                size_t coreBegin = coreEnd - entry.tokens.size();
+                bool prefixed = coreBegin >= 2 && tokens[coreBegin - 2] == "CITY" && tokens[coreBegin - 1] == "OF";
+                bool bare = !entry.needsCitySuffix && !(province && coreEnd > provinceBegin && coreEnd <= provinceEnd);
+                if (citySuffix || prefixed || bare) {
+                    matches = entries;
+                    break;
+                }
+            }
+            if (!matches) continue;
+
+            const Entry* chosen = matches->front();
+            for (const Entry* entry : *matches) {
+                if (province && entry->locality.province == std::string(province->name)) chosen = entry;
+            }
+            result.city = chosen->locality.name;
+            result.province = chosen->locality.province;
+            return result;
+        }
+        if (province) result.province = province->name;
+        return result;
+    }
+
+    // Canonical display name for a city typed by a user, or the input itself
+    static std::string canonicalCity(const std::string& text) {
+        Recognized recognized = recognize(text);
+        return recognized.city.empty() ? text : recognized.city;
+    }
+
+    // Stores the recognized locality on the contact
+    static void annotate(Contact& contact) {
+        Recognized recognized = recognize(contact.getAddress());
+        contact.setLocality(recognized.city, recognized.province);
+    }
+
+    static std::string canonicalProvince(const std::string& text) {
+        std::vector<std::string> tokens = tokenize(text);
+        for (const auto& province : instance().provinces) {
+            if (tokens == province.tokens) return province.name;
+        }
+        return text;
+    }
+
+private:
+    struct Entry {
+        Locality locality;
+        std::vector<std::string> tokens;    // Tokenized core name
+        bool needsCitySuffix;               // Core alone would name a province
+    };
+
+    struct Province {
+        const char* name;
+        std::vector<std::string> tokens;
+    };
+
+    struct Data {
+        std::vector<Entry> entries;
+        std::map<std::string, std::vector<const Entry*>> byCore;
+        std::vector<Province> provinces;
+        // Candidates keyed by their last token, longest names first
+        std::unordered_map<std::string, std::vector<const std::vector<const Entry*>*>> byLast;
+        std::unordered_map<std::string, std::vector<const Province*>> provincesByLast;
+    };
+
+    static bool endsWith(const std::vector<std::string>& tokens, size_t end, const std::vector<std::string>& suffix) {
+        if (suffix.empty() || suffix.size() > end) return false;
+        return std::equal(suffix.begin(), suffix.end(), tokens.begin() + (end - suffix.size()));
+    }
+
+    static const Data& instance() {
+        static const Data data = build();
+        return data;
+    }
+
+    static Data build() {
+        static const Locality localities[] = {
+            // Metro Manila
+            {"Caloocan City", "Caloocan", "Metro Manila"}, {"Las Pinas City", "Las Pinas", "Metro Manila"},
+            {"Makati City", "Makati", "Metro Manila"}, {"Malabon City", "Malabon", "Metro Manila"},
+            {"Mandaluyong City", "Mandaluyong", "Metro Manila"}, {"Manila", "Manila", "Metro Manila"},
+            {"Marikina City", "Marikina", "Metro Manila"}, {"Muntinlupa City", "Muntinlupa", "Metro Manila"},
+            {"Navotas City", "Navotas", "Metro Manila"}, {"Paranaque City", "Paranaque", "Metro Manila"},
+            {"Pasay City", "Pasay", "Metro Manila"}, {"Pasig City", "Pasig", "Metro Manila"},
+            {"Quezon City", "Quezon", "Metro Manila"}, {"San Juan City", "San Juan", "Metro Manila"},
+            {"Taguig City", "Taguig", "Metro Manila"}, {"Valenzuela City", "Valenzuela", "Metro Manila"},
+            {"Pateros", "Pateros", "Metro Manila"},
+            // Luzon
+            {"Baguio City", "Baguio", "Benguet"}, {"Tabuk City", "Tabuk", "Kalinga"},
+            {"Laoag City", "Laoag", "Ilocos Norte"}, {"Batac City", "Batac", "Ilocos Norte"},
+            {"Vigan City", "Vigan", "Ilocos Sur"}, {"Candon City", "Candon", "Ilocos Sur"},
+            {"San Fernando City", "San Fernando", "Pampanga"}, {"San Fernando City", "San Fernando", "La Union"},
+            {"Dagupan City", "Dagupan", "Pangasinan"}, {"Alaminos City", "Alaminos", "Pangasinan"},
+            {"San Carlos City", "San Carlos", "Pangasinan"}, {"Urdaneta City", "Urdaneta", "Pangasinan"},
+            {"Tuguegarao City", "Tuguegarao", "Cagayan"}, {"Ilagan City", "Ilagan", "Isabela"},
+            {"Cauayan City", "Cauayan", "Isabela"}, {"Santiago City", "Santiago", "Isabela"},
+            {"Angeles City", "Angeles", "Pampanga"}, {"Mabalacat City", "Mabalacat", "Pampanga"},
+            {"Balanga City", "Balanga", "Bataan"}, {"Olongapo City", "Olongapo", "Zambales"},
+            {"Tarlac City", "Tarlac", "Tarlac"}, {"Cabanatuan City", "Cabanatuan", "Nueva Ecija"},
+            {"Gapan City", "Gapan", "Nueva Ecija"}, {"Palayan City", "Palayan", "Nueva Ecija"},
+            {"San Jose City", "San Jose", "Nueva Ecija"}, {"Munoz City", "Munoz", "Nueva Ecija"},
+            {"Malolos City", "Malolos", "Bulacan"}, {"Meycauayan City", "Meycauayan", "Bulacan"},
+            {"San Jose del Monte City", "San Jose del Monte", "Bulacan"}, {"Baliwag City", "Baliwag", "Bulacan"},
+            {"Antipolo City", "Antipolo", "Rizal"}, {"Cainta", "Cainta", "Rizal"}, {"Taytay", "Taytay", "Rizal"},
+            {"Rodriguez", "Rodriguez", "Rizal"},
+            {"Bacoor City", "Bacoor", "Cavite"}, {"Imus City", "Imus", "Cavite"},
+            {"Dasmarinas City", "Dasmarinas", "Cavite"}, {"General Trias City", "General Trias", "Cavite"},
+            {"Cavite City", "Cavite", "Cavite"}, {"Tagaytay City", "Tagaytay", "Cavite"},
+            {"Trece Martires City", "Trece Martires", "Cavite"}, {"Carmona City", "Carmona", "Cavite"},
+            {"Calamba City", "Calamba", "Laguna"}, {"Santa Rosa City", "Santa Rosa", "Laguna"},
+            {"Binan City", "Binan", "Laguna"}, {"Cabuyao City", "Cabuyao", "Laguna"},
+            {"San Pedro City", "San Pedro", "Laguna"}, {"San Pablo City", "San Pablo", "Laguna"},
+            {"Batangas City", "Batangas", "Batangas"}, {"Lipa City", "Lipa", "Batangas"},
+            {"Tanauan City", "Tanauan", "Batangas"}, {"Santo Tomas City", "Santo Tomas", "Batangas"},
+            {"Calaca City", "Calaca", "Batangas"},
+            {"Lucena City", "Lucena", "Quezon"}, {"Tayabas City", "Tayabas", "Quezon"},
+            {"Calapan City", "Calapan", "Oriental Mindoro"}, {"Puerto Princesa City", "Puerto Princesa", "Palawan"},
+            {"Naga City", "Naga", "Camarines Sur"}, {"Iriga City", "Iriga", "Camarines Sur"},
+            {"Legazpi City", "Legazpi", "Albay"}, {"Ligao City", "Ligao", "Albay"}, {"Tabaco City", "Tabaco", "Albay"},
+            {"Sorsogon City", "Sorsogon", "Sorsogon"}, {"Masbate City", "Masbate", "Masbate"},
+            // Visayas
+            {"Cebu City", "Cebu", "Cebu"}, {"Lapu-Lapu City", "Lapu-Lapu", "Cebu"},
+            {"Mandaue City", "Mandaue", "Cebu"}, {"Talisay City", "Talisay", "Cebu"},
+            {"Naga City", "Naga", "Cebu"}, {"Danao City", "Danao", "Cebu"}, {"Carcar City", "Carcar", "Cebu"},
+            {"Toledo City", "Toledo", "Cebu"}, {"Bogo City", "Bogo", "Cebu"},
+            {"Consolacion", "Consolacion", "Cebu"}, {"Liloan", "Liloan", "Cebu"},
+            {"Minglanilla", "Minglanilla", "Cebu"}, {"Cordova", "Cordova", "Cebu"},
+            {"Tagbilaran City", "Tagbilaran", "Bohol"},
+            {"Dumaguete City", "Dumaguete", "Negros Oriental"}, {"Bais City", "Bais", "Negros Oriental"},
+            {"Bayawan City", "Bayawan", "Negros Oriental"}, {"Canlaon City", "Canlaon", "Negros Oriental"},
+            {"Guihulngan City", "Guihulngan", "Negros Oriental"}, {"Tanjay City", "Tanjay", "Negros Oriental"},
+            {"Bacolod City", "Bacolod", "Negros Occidental"}, {"Bago City", "Bago", "Negros Occidental"},
+            {"Cadiz City", "Cadiz", "Negros Occidental"}, {"Escalante City", "Escalante", "Negros Occidental"},
+            {"Himamaylan City", "Himamaylan", "Negros Occidental"}, {"Kabankalan City", "Kabankalan", "Negros Occidental"},
+            {"La Carlota City", "La Carlota", "Negros Occidental"}, {"Sagay City", "Sagay", "Negros Occidental"},
+            {"San Carlos City", "San Carlos", "Negros Occidental"}, {"Silay City", "Silay", "Negros Occidental"},
+            {"Sipalay City", "Sipalay", "Negros Occidental"}, {"Talisay City", "Talisay", "Negros Occidental"},
+            {"Victorias City", "Victorias", "Negros Occidental"},
+            {"Iloilo City", "Iloilo", "Iloilo"}, {"Passi City", "Passi", "Iloilo"}, {"Roxas City", "Roxas", "Capiz"},
+            {"Tacloban City", "Tacloban", "Leyte"}, {"Ormoc City", "Ormoc", "Leyte"}, {"Baybay City", "Baybay", "Leyte"},
+            {"Maasin City", "Maasin", "Southern Leyte"}, {"Calbayog City", "Calbayog", "Samar"},
+            {"Catbalogan City", "Catbalogan", "Samar"}, {"Borongan City", "Borongan", "Eastern Samar"},
+            // Mindanao
+            {"Zamboanga City", "Zamboanga", "Zamboanga del Sur"}, {"Pagadian City", "Pagadian", "Zamboanga del Sur"},
+            {"Dipolog City", "Dipolog", "Zamboanga del Norte"}, {"Dapitan City", "Dapitan", "Zamboanga del Norte"},
+            {"Isabela City", "Isabela", "Basilan"}, {"Lamitan City", "Lamitan", "Basilan"},
+            {"Cagayan de Oro City", "Cagayan de Oro", "Misamis Oriental"}, {"Gingoog City", "Gingoog", "Misamis Oriental"},
+            {"El Salvador City", "El Salvador", "Misamis Oriental"}, {"Iligan City", "Iligan", "Lanao del Norte"},
+            {"Marawi City", "Marawi", "Lanao del Sur"}, {"Malaybalay City", "Malaybalay", "Bukidnon"},
+            {"Valencia City", "Valencia", "Bukidnon"}, {"Oroquieta City", "Oroquieta", "Misamis Occidental"},
+            {"Ozamiz City", "Ozamiz", "Misamis Occidental"}, {"Tangub City", "Tangub", "Misamis Occidental"},
+            {"Davao City", "Davao", "Davao del Sur"}, {"Digos City", "Digos", "Davao del Sur"},
+            {"Tagum City", "Tagum", "Davao del Norte"}, {"Panabo City", "Panabo", "Davao del Norte"},
+            {"Samal City", "Samal", "Davao del Norte"}, {"Mati City", "Mati", "Davao Oriental"},
+            {"General Santos City", "General Santos", "South Cotabato"}, {"Koronadal City", "Koronadal", "South Cotabato"},
+            {"Kidapawan City", "Kidapawan", "Cotabato"}, {"Cotabato City", "Cotabato", "Maguindanao del Norte"},
+            {"Tacurong City", "Tacurong", "Sultan Kudarat"},
+            {"Butuan City", "Butuan", "Agusan del Norte"}, {"Cabadbaran City", "Cabadbaran", "Agusan del Norte"},
+            {"Bayugan City", "Bayugan", "Agusan del Sur"}, {"Surigao City", "Surigao", "Surigao del Norte"},
+            {"Bislig City", "Bislig", "Surigao del Sur"}, {"Tandag City", "Tandag", "Surigao del Sur"},
+        };
+        static const char* provinceNames[] = {
+            "Metro Manila", "Benguet", "Kalinga", "Ilocos Norte", "Ilocos Sur", "La Union", "Pangasinan",
+            "Cagayan", "Isabela", "Pampanga", "Bataan", "Zambales", "Tarlac", "Nueva Ecija", "Bulacan",
+            "Rizal", "Cavite", "Laguna", "Batangas", "Quezon", "Oriental Mindoro", "Palawan",
+            "Camarines Sur", "Albay", "Sorsogon", "Masbate", "Cebu", "Bohol", "Negros Oriental",
+            "Negros Occidental", "Iloilo", "Capiz", "Leyte", "Southern Leyte", "Samar", "Eastern Samar",
+            "Zamboanga del Sur", "Zamboanga del Norte", "Basilan", "Misamis Oriental", "Misamis Occidental",
+            "Lanao del Norte", "Lanao del Sur", "Bukidnon", "Davao del Sur", "Davao del Norte",
+            "Davao Oriental", "South Cotabato", "Cotabato", "Maguindanao del Norte", "Sultan Kudarat",
+            "Agusan del Norte", "Agusan del Sur", "Surigao del Norte", "Surigao del Sur",
+        };
+
+        Data data;
+        for (const char* name : provinceNames) data.provinces.push_back({name, tokenize(name)});
+        data.provinces.push_back({"Metro Manila", tokenize("NCR")});
+        // Longer province names first so "Davao del Sur" beats "Davao"
+        std::stable_sort(data.provinces.begin(), data.provinces.end(),
+            [](const Province& a, const Province& b) { return a.tokens.size() > b.tokens.size(); });
+
+        std::set<std::vector<std::string>> provinceTokens;
+        for (const auto& province : data.provinces) provinceTokens.insert(province.tokens);
+
+        data.entries.reserve(std::size(localities));
+        for (const auto& locality : localities) {
+            std::vector<std::string> tokens = tokenize(locality.core);
+            bool needsSuffix = provinceTokens.count(tokens) != 0;
+            data.entries.push_back({locality, tokens, needsSuffix});
+        }
+        for (const auto& entry : data.entries) data.byCore[entry.locality.core].push_back(&entry);
+        for (const auto& [core, entries] : data.byCore) {
+            data.byLast[entries.front()->tokens.back()].push_back(&entries);
+        }
+        for (auto& [last, candidates] : data.byLast) {
+            std::stable_sort(candidates.begin(), candidates.end(), [](const auto* a, const auto* b) {
+                return a->front()->tokens.size() > b->front()->tokens.size();
+            });
+        }
+        for (const auto& province : data.provinces) data.provincesByLast[province.tokens.back()].push_back(&province);
+        return data;
+    }
+};
+
+/*
+ * LocalityIndex Class: Contact ids by recognized city/municipality and by
+ * province, so locality filters are index lookups instead of scans
+ */
+class LocalityIndex : public ContactObserver {
+public:
+    using IdSet = std::set<uint64_t>;
+
+    const IdSet* findCity(const std::string& city) const { return find(byCity, city); }
+    const IdSet* findProvince(const std::string& province) const { return find(byProvince, province); }
+    size_t cityCount() const { return byCity.size(); }
+    size_t provinceCount() const { return byProvince.size(); }
+
+    size_t memoryBytes() const { return hashMapBytes(byCity, setBytes) + hashMapBytes(byProvince, setBytes); }
+
+    void onContactAdded(const Contact& contact) override {
+        if (!contact.getCity().empty()) byCity[upperCopy(contact.getCity())].insert(contact.getId());
+        if (!contact.getProvince().empty()) byProvince[upperCopy(contact.getProvince())].insert(contact.getId());
+    }
+
+    void onContactRemoved(const Contact& contact) override {
+        erase(byCity, contact.getCity(), contact.getId());
+        erase(byProvince, contact.getProvince(), contact.getId());
+    }
+
+    void onContactsReloaded(const std::vector<Contact>& contacts) override {
+        byCity.clear();
+        byProvince.clear();
+        for (const auto& contact : contacts) onContactAdded(contact);
+    }
+
+private:
+    std::unordered_map<std::string, IdSet> byCity;
+    std::unordered_map<std::string, IdSet> byProvince;
+
+    static const IdSet* find(const std::unordered_map<std::string, IdSet>& map, const std::string& key) {
+        auto it = map.find(upperCopy(key));
+        return it == map.end() ? nullptr : &it->second;
+    }
+
+    static void erase(std::unordered_map<std::string, IdSet>& map, const std::string& key, uint64_t id) {
+        if (key.empty()) return;
+        auto it = map.find(upperCopy(key));
+        if (it == map.end()) return;
+        it->second.erase(id);
+        if (it->second.empty()) map.erase(it);
+    }
+};
+
+class QueryNode {
+public:
+    enum class Kind { And, Or, Not, Number, Text };
+
+    virtual ~QueryNode() = default;
+    virtual Kind kind() const = 0;
+    virtual bool matches(const Contact& contact) const = 0;
+};
+
+using QueryNodePtr = std::unique_ptr<QueryNode>;
+
+class AndNode : public QueryNode {
+public:
+    std::vector<QueryNodePtr> children;
+
+    Kind kind() const override { return Kind::And; }
+    bool matches(const Contact& contact) const override {
+        for (const auto& child : children) {
+            if (!child->matches(contact)) return false;
+        }
+        return true;
+    }
+};
+
+class OrNode : public QueryNode {
+public:
+    std::vector<QueryNodePtr> children;
+
+    Kind kind() const override { return Kind::Or; }
+    bool matches(const Contact& contact) const override {
+        for (const auto& child : children) {
+            if (child->matches(contact)) return true;
+        }
+        return false;
+    }
+};
+
+class NotNode : public QueryNode {
+public:
+    QueryNodePtr child;
+
+    Kind kind() const override { return Kind::Not; }
+    bool matches(const Contact& contact) const override { return !child->matches(contact); }
+};
+
+// Every numeric comparison is an inclusive range of values >= 0, possibly
+// negated; a missing value matches neither way
+class NumberPredicate : public QueryNode {
+public:
+    NumberField field;
+    int32_t low;
+    int32_t high;
+    bool negate;
+
+    NumberExtract extract;  // Specialized accessor for field
+
+    NumberPredicate(NumberField field, int32_t low, int32_t high, bool negate)
+        : field(field), low(low), high(high), negate(negate), extract(numberExtractFor(field)) {}
+
+    Kind kind() const override { return Kind::Number; }
+    bool matches(const Contact& contact) const override {
+        int32_t value = numberFieldValue(contact, field);
+        return value != MISSING_NUMBER && (value >= low && value <= high) != negate;
+    }
+};
+
+class TextPredicate : public QueryNode {
+public:
+    TextField field;
+    TextOp op;
+    std::string value;      // Upper case
+    TextTest test;          // Specialized comparison for field and op
+
+    TextPredicate(TextField field, TextOp op, const std::string& value)
+        : field(field), op(op), value(upperCopy(value)), test(textTestFor(field, op)) {}
+
+    Kind kind() const override { return Kind::Text; }
+    // Same comparison as compiled queries, so the two differ only in dispatch
+    bool matches(const Contact& contact) const override { return test(contact, value); }
+};
+
+/*
+ * QueryParser Class: Recursive-descent parser for filter queries.
+ *
+ *     query := and-expr ("or" and-expr)*
+ *     and-expr := term ("and" term)*
+ *     term := "not" term | "(" query ")" | field op value
+ *
+ * Numeric fields (year, month, day, prefix) accept = != < <= > >= and
+ * ranges written low..high; text fields (name, phone, email, address,
+ * birthdate, domain, city) accept = != and ~ (contains). Values containing
+ * spaces are written in double quotes. Throws std::invalid_argument with a
+ * user-facing message on malformed input.
+ */
+class QueryParser {
+public:
+    static QueryNodePtr parse(const std::string& text) {
+        QueryParser parser(text);
+        QueryNodePtr root = parser.parseOr();
+        if (!parser.atEnd()) parser.fail("unexpected '" + parser.peek() + "'");
+        return root;
+    }
+
+private:
+    std::vector<std::string> tokens;
+    size_t position = 0;
+
+    explicit QueryParser(const std::string& text) { tokenize(text); }
+
+    void tokenize(const std::string& text) {
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (c == '(' || c == ')' || c == '~') {
+                tokens.emplace_back(1, c);
+                ++i;
+            } else if (c == '=' || c == '<' || c == '>' || c == '!') {
+                size_t length = (i + 1 < text.size() && text[i + 1] == '=') ? 2 : 1;
+                tokens.push_back(text.substr(i, length));
+                i += length;
+            } else if (c == '"') {
+                size_t close = text.find('"', i + 1);
+                if (close == std::string::npos) fail("missing closing quote");
+                tokens.push_back("\"" + text.substr(i + 1, close - i - 1));
+                i = close + 1;
+            } else {
+                size_t start = i;
+                while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) &&
+                       std::string("()~=<>!\"").find(text[i]) == std::string::npos) {
+                    ++i;
+                }
+                tokens.push_back(text.substr(start, i - start));
+            }
+        }
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::invalid_argument("Invalid query: " + message);
+    }
+
+    bool atEnd() const { return position >= tokens.size(); }
+    std::string peek() const { return atEnd() ? "" : tokens[position]; }
+
+    std::string next(const std::string& expected) {
+        if (atEnd()) fail("expected " + expected);
+        return tokens[position++];
+    }
+
+    bool acceptKeyword(const std::string& keyword) {
+        if (!atEnd() && upperCopy(tokens[position]) == keyword) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    QueryNodePtr parseOr() {
+        QueryNodePtr first = parseAnd();
+        if (upperCopy(peek()) != "OR") return first;
+        auto node = std::make_unique<OrNode>();
+        node->children.push_back(std::move(first));
+        while (acceptKeyword("OR")) node->children.push_back(parseAnd());
+        return node;
+    }
+
+    QueryNodePtr parseAnd() {
+        QueryNodePtr first = parseTerm();
+        if (upperCopy(peek()) != "AND") return first;
+        auto node = std::make_unique<AndNode>();
+        node->children.push_back(std::move(first));
+        while (acceptKeyword("AND")) node->children.push_back(parseTerm());
+        return node;
+    }
+
+    QueryNodePtr parseTerm() {
+        if (acceptKeyword("NOT")) return negated(parseTerm());
+        if (peek() == "(") {
+            ++position;
+            QueryNodePtr inner = parseOr();
+            if (next("')'") != ")") fail("expected ')'");
+            return inner;
+        }
+        return parseComparison();
+    }
+
+    /*
+     * "not" applied to node, pushed down to the comparisons (De Morgan for
+     * and/or). A negated numeric comparison still rejects missing values,
+     * so "not year>=1900" does not match a contact without a birth year.
+     * Only text comparisons, which always have a value, keep a NotNode.
+     */
+    static QueryNodePtr negated(QueryNodePtr node) {
+        switch (node->kind()) {
+            case QueryNode::Kind::Number: {
+                auto& predicate = static_cast<NumberPredicate&>(*node);
+                predicate.negate = !predicate.negate;
+                return node;
+            }
+            case QueryNode::Kind::Text: {
+                auto result = std::make_unique<NotNode>();
+                result->child = std::move(node);
+                return result;
+            }
+            case QueryNode::Kind::Not:
+                return std::move(static_cast<NotNode&>(*node).child);
+            case QueryNode::Kind::And: {
+                auto result = std::make_unique<OrNode>();
+                for (auto& child : static_cast<AndNode&>(*node).children) result->children.push_back(negated(std::move(child)));
+                return result;
+            }
+            case QueryNode::Kind::Or: {
+                auto result = std::make_unique<AndNode>();
+                for (auto& child : static_cast<OrNode&>(*node).children) result->children.push_back(negated(std::move(child)));
+                return result;
+            }
+        }
+        return node;
+    }
+
+    static int32_t parseNumber(const std::string& text, const std::string& field) {
+        if (text.empty() || text.size() > 9 ||
+            !std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+            throw std::invalid_argument("Invalid query: '" + text + "' is not a number for " + field);
+        }
+        return std::stoi(text);
+    }
+
+    QueryNodePtr parseComparison() {
+        std::string field = upperCopy(next("a field name"));
+        std::string op = next("an operator after " + field);
+        std::string value = next("a value after " + field + " " + op);
+        if (!value.empty() && value[0] == '"') value.erase(0, 1);
+
+        static const std::map<std::string, NumberField> numberFields = {
+            {"YEAR", NumberField::Year}, {"MONTH", NumberField::Month},
+            {"DAY", NumberField::Day}, {"PREFIX", NumberField::PhonePrefix}
+        };
+        static const std::map<std::string, TextField> textFields = {
+            {"NAME", TextField::Name}, {"PHONE", TextField::Phone}, {"EMAIL", TextField::Email},
+            {"ADDRESS", TextField::Address}, {"BIRTHDATE", TextField::Birthdate},
+            {"DOMAIN", TextField::Domain}, {"CITY", TextField::City}, {"PROVINCE", TextField::Province}
+        };
+
+        if (auto it = numberFields.find(field); it != numberFields.end()) {
+            size_t dots = value.find("..");
+            if (dots != std::string::npos) {
+                if (op != "=") fail("ranges must be written as " + field + "=low..high");
+                return std::make_unique<NumberPredicate>(it->second, parseNumber(value.substr(0, dots), field),
+                                                         parseNumber(value.substr(dots + 2), field), false);
+            }
+            int32_t number = parseNumber(value, field);
+            if (op == "=") return std::make_unique<NumberPredicate>(it->second, number, number, false);
+            if (op == "!=") return std::make_unique<NumberPredicate>(it->second, number, number, true);
+            if (op == "<") return std::make_unique<NumberPredicate>(it->second, 0, number - 1, false);
+            if (op == "<=") return std::make_unique<NumberPredicate>(it->second, 0, number, false);
+            if (op == ">") return std::make_unique<NumberPredicate>(it->second, number + 1, INT32_MAX, false);
+            if (op == ">=") return std::make_unique<NumberPredicate>(it->second, number, INT32_MAX, false);
+            fail("operator '" + op + "' cannot be used with " + field);
+        }
+        if (auto it = textFields.find(field); it != textFields.end()) {
+            // "lapu-lapu" and "City of Lapu-Lapu" both mean "Lapu-Lapu City"
+            if (op != "~" && it->second == TextField::City) value = Gazetteer::canonicalCity(value);
+            if (op != "~" && it->second == TextField::Province) value = Gazetteer::canonicalProvince(value);
+            if (op == "=") return std::make_unique<TextPredicate>(it->second, TextOp::Equals, value);
+            if (op == "!=") return std::make_unique<TextPredicate>(it->second, TextOp::NotEquals, value);
+            if (op == "~") return std::make_unique<TextPredicate>(it->second, TextOp::Contains, value);
+            fail("operator '" + op + "' cannot be used with " + field);
+        }
+        fail("unknown field '" + field + "'");
+    }
+};
+
+/*
+ * CompiledQuery Class: A query tree flattened into a branch program. Each
+ * instruction is one leaf predicate bound to a field accessor instantiated
+ * for that field (and operator), plus the instruction to continue with when
+ * the leaf is true or false. And/or/not are resolved into these jump
+ * targets at compile time, so evaluating a row is a short loop with no
+ * virtual calls and no allocations.
+ */
+class CompiledQuery {
+public:
+    explicit CompiledQuery(const QueryNode& root) {
+        entry = compile(root, ACCEPT, REJECT);
+    }
+
+    bool matches(const Contact& contact) const {
+        int32_t next = entry;
+        while (next >= 0) {
+            const Instruction& instruction = program[static_cast<size_t>(next)];
+            bool result;
+            if (instruction.textTest) {
+                result = instruction.textTest(contact, instruction.value);
+            } else {
+                int32_t value = instruction.extract(contact);
+                result = value != MISSING_NUMBER && (value >= instruction.low && value <= instruction.high) != instruction.negate;
+            }
+            next = result ? instruction.onTrue : instruction.onFalse;
+        }
+        return next == ACCEPT;
+    }
+
+    size_t size() const { return program.size(); }
+
+private:
+    static constexpr int32_t ACCEPT = -1;
+    static constexpr int32_t REJECT = -2;
+
+    struct Instruction {
+        NumberExtract extract = nullptr;
+        int32_t low = 0;
+        int32_t high = 0;
+        bool negate = false;
+        TextTest textTest = nullptr;
+        std::string value;
+        int32_t onTrue = ACCEPT;
+        int32_t onFalse = REJECT;
+    };
+
+    std::vector<Instruction> program;
+    int32_t entry = ACCEPT;
+
+    // Emit node so that it continues at onTrue/onFalse; returns its entry
+    int32_t compile(const QueryNode& node, int32_t onTrue, int32_t onFalse) {
+        switch (node.kind()) {
+            case QueryNode::Kind::Number: {
+                const auto& predicate = static_cast<const NumberPredicate&>(node);
+                Instruction instruction;
+                instruction.extract = predicate.extract;
+                instruction.low = predicate.low;
+                instruction.high = predicate.high;
+                instruction.negate = predicate.negate;
+                return emit(std::move(instruction), onTrue, onFalse);
+            }
+            case QueryNode::Kind::Text: {
+                const auto& predicate = static_cast<const TextPredicate&>(node);
+                Instruction instruction;
+                instruction.textTest = predicate.test;
+                instruction.value = predicate.value;
+                return emit(std::move(instruction), onTrue, onFalse);
+            }
+            case QueryNode::Kind::Not:
+                return compile(*static_cast<const NotNode&>(node).child, onFalse, onTrue);
+            case QueryNode::Kind::And: {
+                // Later children are emitted first so earlier ones can jump to them
+                const auto& children = static_cast<const AndNode&>(node).children;
+                int32_t next = onTrue;
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    next = compile(**it, next, onFalse);
+                }
+                return next;
+            }
+            case QueryNode::Kind::Or: {
+                const auto& children = static_cast<const OrNode&>(node).children;
+                int32_t next = onFalse;
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    next = compile(**it, onTrue, next);
+                }
+                return next;
+            }
+        }
+        return REJECT;
+    }
+
+    int32_t emit(Instruction instruction, int32_t onTrue, int32_t onFalse) {
+        instruction.onTrue = onTrue;
+        instruction.onFalse = onFalse;
+        program.push_back(std::move(instruction));
+        return static_cast<int32_t>(program.size() - 1);
+    }
+};
+
+/*
+ * ColumnStore Class: Packed int32 columns of the numeric query fields,
+ * row-aligned with the contact list. Appends are applied in place; any
+ * other change marks the columns stale until the next rebuild().
+ */
+class ColumnStore : public ContactObserver {
+public:
+    static constexpr size_t COLUMN_COUNT = 4;   // One per NumberField
+
+    bool isStale() const { return stale; }
+    size_t rows() const { return columns[0].size(); }
+
+    // Safe from any thread, also while a filter rebuilds the columns on the pool
+    size_t memoryBytes() const { return bytes.load(std::memory_order_relaxed); }
+
+    const int32_t* column(NumberField field) const {
+        return columns[static_cast<size_t>(field)].data();
+    }
+
+    void rebuild(const std::vector<Contact>& contacts) {
+        for (auto& values : columns) values.clear();
+        for (const auto& contact : contacts) append(contact);
+        stale = false;
+        publishBytes();
+    }
+
+    void onContactAdded(const Contact& contact) override {
+        if (stale) return;
+        append(contact);
+        publishBytes();
+    }
+    void onContactRemoved(const Contact&) override { stale = true; }
+    void onContactModified(const Contact&, const Contact&) override { stale = true; }
+    void onContactsReloaded(const std::vector<Contact>&) override { stale = true; }
+
+private:
+    std::vector<int32_t> columns[COLUMN_COUNT];
+    bool stale = true;
+    std::atomic<size_t> bytes{0};       // Heap bytes of columns, as of the last change
+
+    void publishBytes() {
+        size_t total = 0;
+        for (const auto& values : columns) total += values.capacity() * sizeof(int32_t);
+        bytes.store(total, std::memory_order_relaxed);
+    }
+
+    void append(const Contact& contact) {
+        for (size_t i = 0; i < COLUMN_COUNT; ++i) {
+            columns[i].push_back(numberFieldValue(contact, static_cast<NumberField>(i)));
+        }
+    }
+};
+
+/*
+ * FilterEngine Class: Evaluates a query tree over a block of rows into a
+ * selection bitmap (bit i set = row begin + i selected). Numeric predicates
+ * run as SIMD range checks over the packed columns and are combined with
+ * bitwise operations; text predicates are evaluated last and only for rows
+ * still selected, so string data is touched as little as possible.
+ */
+class FilterEngine {
+public:
+    using Bitmap = std::vector<uint64_t>;
+
+    static size_t wordsFor(size_t rows) { return (rows + 63) / 64; }
+
+    // begin must be a multiple of 64 so blocks map to whole bitmap words.
+    // Rows is indexable like a vector of contacts.
+    template<typename Rows>
+    static Bitmap evaluate(const QueryNode& node, const ColumnStore& columns,
+                           const Rows& contacts, size_t begin, size_t end) {
+        Bitmap candidates(wordsFor(end - begin), ~uint64_t(0));
+        clearTail(candidates, end - begin);
+        return evaluateWithin(node, columns, contacts, begin, end, candidates);
+    }
+
+    static size_t count(const Bitmap& bitmap) {
+        size_t total = 0;
+        for (uint64_t word : bitmap) total += static_cast<size_t>(__builtin_popcountll(word));
+        return total;
+    }
+
+    // Sets bit i for every values[i] in [low, high] (count rows)
+    static void selectRange(const int32_t* values, size_t count, int32_t low, int32_t high, uint64_t* out) {
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        if (hasAvx2) {
+            selectRangeAvx2(values, count, low, high, out);
+            return;
+        }
+        selectRangeSse2(values, count, low, high, out);
+#else
+        selectRangeScalar(values, 0, count, low, high, out);
+#endif
+    }
+
+private:
+    static void clearTail(Bitmap& bitmap, size_t rows) {
+        if (rows % 64 != 0 && !bitmap.empty()) bitmap.back() &= (uint64_t(1) << (rows % 64)) - 1;
+    }
+
+    static bool isColumnar(const QueryNode& node) {
+        switch (node.kind()) {
+            case QueryNode::Kind::Number: return true;
+            case QueryNode::Kind::Text: return false;
+            case QueryNode::Kind::Not: return isColumnar(*static_cast<const NotNode&>(node).child);
+            case QueryNode::Kind::And:
+                for (const auto& child : static_cast<const AndNode&>(node).children) {
+                    if (!isColumnar(*child)) return false;
+                }
+                return true;
+            case QueryNode::Kind::Or:
+                for (const auto& child : static_cast<const OrNode&>(node).children) {
+                    if (!isColumnar(*child)) return false;
+                }
+                return true;
+        }
+        return false;
+    }
+
+    // Result is restricted to rows set in candidates
+    template<typename Rows>
+    static Bitmap evaluateWithin(const QueryNode& node, const ColumnStore& columns,
+                                 const Rows& contacts, size_t begin, size_t end,
+                                 const Bitmap& candidates) {
+        size_t words = candidates.size();
+        Bitmap result(words, 0);
+
+        switch (node.kind()) {
+            case QueryNode::Kind::Number: {
+                const auto& predicate = static_cast<const NumberPredicate&>(node);
+                const int32_t* values = columns.column(predicate.field) + begin;
+                selectRange(values, end - begin, predicate.low, predicate.high, result.data());
+                if (predicate.negate) {
+                    // Ranges never include MISSING_NUMBER, but their complement would
+                    Bitmap present(words, 0);
+                    selectRange(values, end - begin, 0, INT32_MAX, present.data());
+                    for (size_t w = 0; w < words; ++w) result[w] = ~result[w] & present[w];
+                }
+                for (size_t w = 0; w < words; ++w) result[w] &= candidates[w];
+                break;
+            }
+            case QueryNode::Kind::Text: {
+                const auto& predicate = static_cast<const TextPredicate&>(node);
+                for (size_t w = 0; w < words; ++w) {
+                    for (uint64_t bits = candidates[w]; bits; bits &= bits - 1) {
+                        size_t row = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                        if (predicate.test(contacts[begin + row], predicate.value)) result[w] |= uint64_t(1) << (row % 64);
+                    }
+                }
+                break;
+            }
+            case QueryNode::Kind::Not: {
+                Bitmap inner = evaluateWithin(*static_cast<const NotNode&>(node).child,
+                                              columns, contacts, begin, end, candidates);
+                for (size_t w = 0; w < words; ++w) result[w] = ~inner[w] & candidates[w];
+                break;
+            }
+            case QueryNode::Kind::And: {
+                // Columnar children first so text children see fewer rows
+                const auto& children = static_cast<const AndNode&>(node).children;
+                result = candidates;
+                for (int pass = 0; pass < 2; ++pass) {
+                    for (const auto& child : children) {
+                        if (isColumnar(*child) != (pass == 0)) continue;
+                        result = evaluateWithin(*child, columns, contacts, begin, end, result);
+                    }
+                }
+                break;
+            }
+            case QueryNode::Kind::Or: {
+                // Text children only need to look at rows not selected yet
+                const auto& children = static_cast<const OrNode&>(node).children;
+                for (int pass = 0; pass < 2; ++pass) {
+                    for (const auto& child : children) {
+                        if (isColumnar(*child) != (pass == 0)) continue;
+                        Bitmap remaining(words);
+                        for (size_t w = 0; w < words; ++w) remaining[w] = candidates[w] & ~result[w];
+                        Bitmap matched = evaluateWithin(*child, columns, contacts, begin, end, remaining);
+                        for (size_t w = 0; w < words; ++w) result[w] |= matched[w];
+                    }
+                }
+                break;
+            }
+        }
+        return result;
+    }
+
+    static void selectRangeScalar(const int32_t* values, size_t from, size_t count,
+                                  int32_t low, int32_t high, uint64_t* out) {
+        for (size_t i = from; i < count; ++i) {
+            if (values[i] >= low && values[i] <= high) out[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    static void selectRangeSse2(const int32_t* values, size_t count, int32_t low, int32_t high, uint64_t* out) {
+        const __m128i lowVector = _mm_set1_epi32(low);
+        const __m128i highVector = _mm_set1_epi32(high);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+            __m128i outside = _mm_or_si128(_mm_cmplt_epi32(v, lowVector), _mm_cmpgt_epi32(v, highVector));
+            uint64_t bits = static_cast<uint64_t>(~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF);
+            out[i / 64] |= bits << (i % 64);
+        }
+        selectRangeScalar(values, i, count, low, high, out);
+    }
+
+    __attribute__((target("avx2")))
+    static void selectRangeAvx2(const int32_t* values, size_t count, int32_t low, int32_t high, uint64_t* out) {
+        const __m256i lowVector = _mm256_set1_epi32(low);
+        const __m256i highVector = _mm256_set1_epi32(high);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+            __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lowVector, v), _mm256_cmpgt_epi32(v, highVector));
+            uint64_t bits = static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF);
+            out[i / 64] |= bits << (i % 64);
+        }
+        selectRangeScalar(values, i, count, low, high, out);
+    }
+#endif
+};
+
+/*
+ * BatchValidator Class: Validates the fixed-format fields of many contacts
+ * at once and returns a validity bitmap (bit i for row begin + i), with the
+ * same result as InputValidator's checks. Phones and birthdates are copied
+ * column-wise into a block, byte k of 32 fields side by side, so AVX2 can
+ * check one character position of 32 fields per instruction; without AVX2
+ * the scalar checks fill the bitmap instead.
+ */
+class BatchValidator {
+public:
+    using Bitmap = FilterEngine::Bitmap;
+
+    template<typename Rows>
+    static Bitmap validPhones(const Rows& rows, size_t begin, size_t end) {
+        return validate<Format::Phone>(rows, begin, end);
+    }
+
+    template<typename Rows>
+    static Bitmap validBirthdates(const Rows& rows, size_t begin, size_t end) {
+        return validate<Format::Birthdate>(rows, begin, end);
+    }
+
+    // Rows whose every field is valid: phones and birthdates in batches, the free-form fields one by one
+    template<typename Rows>
+    static Bitmap validContacts(const Rows& rows, size_t begin, size_t end) {
+        Bitmap valid = validPhones(rows, begin, end);
+        Bitmap dates = validBirthdates(rows, begin, end);
+        for (size_t w = 0; w < valid.size(); ++w) {
+            uint64_t word = valid[w] & dates[w];
+            for (uint64_t bits = word; bits; bits &= bits - 1) {
+                const Contact& contact = rows[begin + w * 64 + static_cast<size_t>(__builtin_ctzll(bits))];
+                if (InputValidator::checkName(contact.getName()) != ValidationError::None ||
+                    InputValidator::checkEmail(contact.getEmail()) != ValidationError::None ||
+                    InputValidator::checkAddress(contact.getAddress()) != ValidationError::None) {
+                    word &= ~(bits & -bits);
+                }
+            }
+            valid[w] = word;
+        }
+        return valid;
+    }
+
+private:
+    enum class Format { Phone, Birthdate };
+    static constexpr size_t PHONE_LENGTH = 11;
+    static constexpr size_t DATE_LENGTH = 10;
+    static constexpr size_t BLOCK = 32;     // Fields per block, one per byte of an AVX2 register
+
+    template<Format F>
+    static const std::string& fieldOf(const Contact& contact) {
+        return F == Format::Phone ? contact.getPhoneNumber() : contact.getBirthdate();
+    }
+
+    template<Format F>
+    static ValidationError check(std::string_view text) {
+        return F == Format::Phone ? InputValidator::checkPhoneNumber(text) : InputValidator::checkBirthdate(text);
+    }
+
+    /*
+     * Copies byte k of each field of rows [first, first + BLOCK) to
+     * block[k * BLOCK + row]; fields of the wrong length are left as zero
+     * bytes, which no check accepts.
+     */
+    template<Format F, size_t Length, typename Rows>
+    static void stage(const Rows& rows, size_t first, size_t count, uint8_t (&block)[Length * BLOCK]) {
+        std::memset(block, 0, sizeof(block));
+        for (size_t row = 0; row < count; ++row) {
+            const std::string& text = fieldOf<F>(rows[first + row]);
+            if (text.size() != Length) continue;
+            for (size_t k = 0; k < Length; ++k) block[k * BLOCK + row] = static_cast<uint8_t>(text[k]);
+        }
+    }
+
+    template<Format F, typename Rows>
+    static Bitmap validate(const Rows& rows, size_t begin, size_t end) {
+        Bitmap valid(FilterEngine::wordsFor(end - begin), 0);
+#if defined(__x86_64__) || defined(__i386__)
+        static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+        if (hasAvx2) {
+            constexpr size_t LENGTH = F == Format::Phone ? PHONE_LENGTH : DATE_LENGTH;
+            alignas(32) uint8_t block[LENGTH * BLOCK];
+            for (size_t first = 0; first < end - begin; first += BLOCK) {
+                size_t count = std::min(BLOCK, end - begin - first);
+                stage<F, LENGTH>(rows, begin + first, count, block);
+                uint64_t bits = F == Format::Phone ? phoneBlockMask(block) : dateBlockMask(block);
+                if (count < BLOCK) bits &= (uint64_t(1) << count) - 1;
+                valid[first / 64] |= bits << (first % 64);
+            }
+            return valid;
+        }
+#endif
+        for (size_t i = 0; i < end - begin; ++i) {
+            if (check<F>(fieldOf<F>(rows[begin + i])) == ValidationError::None) valid[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        return valid;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("avx2")))
+    static __m256i column(const uint8_t* block, size_t k) {
+        return _mm256_load_si256(reinterpret_cast<const __m256i*>(block + k * BLOCK));
+    }
+
+    // 0xFF in each byte of x that lies in [low, high] (unsigned)
+    __attribute__((target("avx2")))
+    static __m256i inRange(__m256i x, uint8_t low, uint8_t high) {
+        return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(static_cast<char>(low))), x),
+                                _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(static_cast<char>(high))), x));
+    }
+
+    __attribute__((target("avx2")))
+    static __m256i equals(__m256i x, char c) { return _mm256_cmpeq_epi8(x, _mm256_set1_epi8(c)); }
+
+    // Two digit columns as the number they spell, for bytes already known to be digits
+    __attribute__((target("avx2")))
+    static __m256i twoDigits(__m256i tens, __m256i ones) {
+        const __m256i zero = _mm256_set1_epi8('0');
+        __m256i t = _mm256_sub_epi8(tens, zero);
+        __m256i twice = _mm256_add_epi8(t, t);
+        __m256i eight = _mm256_add_epi8(_mm256_add_epi8(twice, twice), _mm256_add_epi8(twice, twice));
+        return _mm256_add_epi8(_mm256_add_epi8(twice, eight), _mm256_sub_epi8(ones, zero));
+    }
+
+    __attribute__((target("avx2")))
+    static uint64_t phoneBlockMask(const uint8_t* block) {
+        __m256i ok = _mm256_and_si256(equals(column(block, 0), '0'), equals(column(block, 1), '9'));
+        for (size_t k = 2; k < PHONE_LENGTH; ++k) ok = _mm256_and_si256(ok, inRange(column(block, k), '0', '9'));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(ok));
+    }
+
+    // DD/MM/YYYY with day 1-31, month 1-12 and year 1900-2025
+    __attribute__((target("avx2")))
+    static uint64_t dateBlockMask(const uint8_t* block) {
+        __m256i ok = _mm256_and_si256(equals(column(block, 2), '/'), equals(column(block, 5), '/'));
+        for (size_t k : {0, 1, 3, 4, 6, 7, 8, 9}) ok = _mm256_and_si256(ok, inRange(column(block, k), '0', '9'));
+        __m256i century = twoDigits(column(block, 6), column(block, 7));
+        __m256i yearOk = _mm256_or_si256(_mm256_cmpeq_epi8(century, _mm256_set1_epi8(19)),
+                                         _mm256_and_si256(_mm256_cmpeq_epi8(century, _mm256_set1_epi8(20)),
+                                                          inRange(twoDigits(column(block, 8), column(block, 9)), 0, 25)));
+        ok = _mm256_and_si256(ok, inRange(twoDigits(column(block, 0), column(block, 1)), 1, 31));
+        ok = _mm256_and_si256(ok, inRange(twoDigits(column(block, 3), column(block, 4)), 1, 12));
+        ok = _mm256_and_si256(ok, yearOk);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(ok));
+    }
+#endif
+};
+
+/*
+ * SavedSearches Class: Named filter queries whose result sets are kept
+ * materialized. Each change re-evaluates only the changed contact against
+ * every saved query, so opening a saved search needs no scan at all.
+ * Definitions are persisted to a small text file (name and query per pair
+ * of lines, checksummed as one block, see ChecksumLines); results are
+ * rebuilt on load.
+ */
+class SavedSearches : public ContactObserver {
+public:
+    struct Search {
+        std::string name;
+        std::string queryText;
+        CompiledQuery query;
+        std::set<uint64_t> matchingIds;     // Ascending ids, i.e. list order
+    };
+
+    explicit SavedSearches(const std::string& path = "saved_searches.txt") : path(path) {}
+
+    const std::vector<Search>& all() const { return searches; }
+
+    // Approximate bytes of the materialized result sets
+    size_t memoryBytes() const {
+        size_t bytes = 0;
+        for (const auto& search : searches) bytes += setBytes(search.matchingIds);
+        return bytes;
+    }
+
+    // Reads stored definitions; malformed entries are skipped, and none are
+    // loaded if the file fails its checksum
+    template<typename Rows>
+    void loadDefinitions(const Rows& contacts) {
+        std::ifstream inFile(path);
+        std::vector<std::pair<std::string, std::string>> definitions;
+        std::string name, queryText;
+        bool checked = false;
+        std::optional<ChecksumLines::Trailer> trailer;
+        uint32_t crc = 0;
+        while (std::getline(inFile, name)) {
+            if (definitions.empty() && !checked && name == ChecksumLines::HEADER) {
+                checked = true;
+                continue;
+            }
+            if (checked && ChecksumLines::isTrailer(name)) {
+                trailer = ChecksumLines::parseTrailer(name);
+                break;
+            }
+            if (!std::getline(inFile, queryText)) break;
+            crc = Crc32c::compute(name + '\n' + queryText + '\n', crc);
+            definitions.emplace_back(std::move(name), std::move(queryText));
+        }
+        if (checked && (!trailer || trailer->records != definitions.size() || trailer->crc != crc)) {
+            std::cerr << "Warning: '" << path << "' fails its checksum; saved searches were not loaded.\n";
+            return;
+        }
+        for (const auto& [searchName, searchQuery] : definitions) {
+            try {
+                add(searchName, searchQuery, contacts, false);
+            } catch (const std::invalid_argument&) {
+                std::cerr << "Warning: skipping saved search '" << searchName << "' with an invalid query.\n";
+            }
+        }
+    }
+
+    // Throws std::invalid_argument if the query does not parse. Rows is
+    // indexable like a vector of contacts.
+    template<typename Rows>
+    void add(const std::string& name, const std::string& queryText,
+             const Rows& contacts, bool persist = true) {
+        QueryNodePtr tree = QueryParser::parse(queryText);
+        Search search{name, queryText, CompiledQuery(*tree), {}};
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            const Contact& contact = contacts[i];
+            if (search.query.matches(contact)) search.matchingIds.insert(contact.getId());
+        }
+        searches.push_back(std::move(search));
+        if (persist) saveDefinitions();
+    }
+
+    void remove(size_t index) {
+        searches.erase(searches.begin() + index);
+        saveDefinitions();
+    }
+
+    void onContactAdded(const Contact& contact) override {
+        for (auto& search : searches) {
+            if (search.query.matches(contact)) search.matchingIds.insert(contact.getId());
+        }
+    }
+
+    void onContactRemoved(const Contact& contact) override {
+        for (auto& search : searches) search.matchingIds.erase(contact.getId());
+    }
+
+    void onContactModified(const Contact&, const Contact& after) override {
+        for (auto& search : searches) {
+            if (search.query.matches(after)) {
+                search.matchingIds.insert(after.getId());
+            } else {
+                search.matchingIds.erase(after.getId());
+            }
+        }
+    }
+
+    void onContactsReloaded(const std::vector<Contact>& contacts) override {
+        for (auto& search : searches) {
+            search.matchingIds.clear();
+            for (const auto& contact : contacts) {
+                if (search.query.matches(contact)) search.matchingIds.insert(search.matchingIds.end(), contact.getId());
+            }
+        }
+    }
+
+private:
+    std::string path;
+    std::vector<Search> searches;
+
+    void saveDefinitions() const {
+        std::ofstream outFile(path);
+        if (!outFile) {
+            std::cerr << "Error: Unable to save searches to '" << path << "'.\n";
+            return;
+        }
+        std::string body;
+        for (const auto& search : searches) body += search.name + '\n' + search.queryText + '\n';
+        outFile << ChecksumLines::HEADER << '\n' << body
+                << ChecksumLines::trailer(searches.size(), Crc32c::compute(body)) << '\n';
+    }
+};
+
+/*
+ * OperationTrace Class: Timing of one ContactBook operation split into
+ * named phases, with its (already redacted) parameters and the number of
+ * allocations made for it: on the constructing thread while the trace
+ * lives, and in pool tasks queued from there, but not in periodic timers.
+ */
+class OperationTrace {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    OperationTrace(std::string operation, std::string parameters = "")
+        : operation(std::move(operation)), parameters(std::move(parameters)),
+          started(Clock::now()), phaseStarted(started), scope(&ownAllocations) {}
+
+    // Ends the current phase under the given name and starts the next one
+    void phase(const std::string& name) {
+        auto now = Clock::now();
+        phases.emplace_back(name, std::chrono::duration<double, std::milli>(now - phaseStarted).count());
+        phaseStarted = now;
+    }
+
+    double elapsedMs() const { return std::chrono::duration<double, std::milli>(Clock::now() - started).count(); }
+    uint64_t allocations() const { return ownAllocations.load(std::memory_order_relaxed); }
+    const std::string& getOperation() const { return operation; }
+    const std::string& getParameters() const { return parameters; }
+    const std::vector<std::pair<std::string, double>>& getPhases() const { return phases; }
+
+    // Stands in for a user-supplied value in logged parameters
+    static std::string redact(const std::string& value) {
+        return "<" + std::to_string(value.size()) + " chars>";
+    }
+
+    // Keeps the fields and operators of a filter query, hides its values
+    static std::string redactQuery(const std::string& query) {
+        std::string redacted;
+        size_t i = 0;
+        while (i < query.size()) {
+            char c = query[i];
+            redacted.push_back(c);
+            ++i;
+            if (c != '=' && c != '~' && c != '<' && c != '>') continue;
+            if (i < query.size() && query[i] == '=') redacted.push_back(query[i++]);
+            while (i < query.size() && query[i] == ' ') redacted.push_back(query[i++]);
+            if (i < query.size() && query[i] == '"') {
+                size_t close = query.find('"', i + 1);
+                i = close == std::string::npos ? query.size() : close + 1;
+            } else {
+                while (i < query.size() && query[i] != ' ' && query[i] != ')') ++i;
+            }
+            redacted.push_back('?');
+        }
+        return redacted;
+    }
+
+private:
+    std::string operation;
+    std::string parameters;
+    Clock::time_point started;
+    Clock::time_point phaseStarted;
+    std::atomic<uint64_t> ownAllocations{0};
+    AllocationScope scope;      // Declared after ownAllocations, which it points to
+    std::vector<std::pair<std::string, double>> phases;
+};
+
+/*
+ * SlowOperationLog Class: Appends operations that took longer than the
+ * threshold to slow_operations.log, one line per operation
+ */
+class SlowOperationLog {
+public:
+    static constexpr double DEFAULT_THRESHOLD_MS = 500;
+
+    void setThresholdMs(double ms) { thresholdMs = ms; }
+    double getThresholdMs() const { return thresholdMs; }
+
+    // Returns true if the operation was slow
+    bool submit(const OperationTrace& trace, size_t bookSize) const {
+        double elapsedMs = trace.elapsedMs();
+        if (elapsedMs < thresholdMs) return false;
+
+        std::ofstream logFile(path, std::ios::app);
+        if (!logFile) return true;
+        std::time_t now = std::time(nullptr);
+        std::tm local{};
+        localtime_r(&now, &local);
+        logFile << std::put_time(&local, "%Y-%m-%d %H:%M:%S") << " slow " << trace.getOperation()
+                << std::fixed << std::setprecision(2) << ' ' << elapsedMs << " ms"
+                << " contacts=" << bookSize << " allocations=" << trace.allocations();
+        if (!trace.getParameters().empty()) logFile << " params: " << trace.getParameters();
+        if (!trace.getPhases().empty()) {
+            logFile << " phases:";
+            for (const auto& [name, ms] : trace.getPhases()) logFile << ' ' << name << '=' << ms;
+        }
+        logFile << '\n';
+        return true;
+    }
+
+private:
+    std::string path = "slow_operations.log";
+    double thresholdMs = DEFAULT_THRESHOLD_MS;
+};
+
+/*
+ * StartupProfile Class: Wall time, process CPU time (all threads) and bytes
+ * per startup phase. A phase may be measured several times, e.g. once per
+ * block read, and its totals accumulate in first-seen order.
+ */
+class StartupProfile {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase {
+        std::string name;
+        double wallMs = 0;
+        double cpuMs = 0;
+        uint64_t bytes = 0;
+    };
+
+    // Measures from construction to destruction into the named phase
+    class Scope {
+    public:
+        Scope(StartupProfile& profile, std::string name, uint64_t bytes)
+            : profile(profile), name(std::move(name)), bytes(bytes),
+              wallStarted(Clock::now()), cpuStarted(cpuNowMs()) {}
+        ~Scope() {
+            double wall = std::chrono::duration<double, std::milli>(Clock::now() - wallStarted).count();
+            profile.add(name, wall, cpuNowMs() - cpuStarted, bytes);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void addBytes(uint64_t more) { bytes += more; }
+
+    private:
+        StartupProfile& profile;
+        std::string name;
+        uint64_t bytes;
+        Clock::time_point wallStarted;
+        double cpuStarted;
+    };
+
+    Scope measure(std::string name, uint64_t bytes = 0) { return Scope(*this, std::move(name), bytes); }
+
+    void add(const std::string& name, double wallMs, double cpuMs, uint64_t bytes) {
+        auto it = std::find_if(phases.begin(), phases.end(), [&name](const Phase& phase) { return phase.name == name; });
+        if (it == phases.end()) it = phases.insert(phases.end(), Phase{name});
+        it->wallMs += wallMs;
+        it->cpuMs += cpuMs;
+        it->bytes += bytes;
+    }
+
+    const std::vector<Phase>& all() const { return phases; }
+
+    double wallMs(const std::string& name) const {
+        for (const auto& phase : phases) {
+            if (phase.name == name) return phase.wallMs;
+        }
+        return 0;
+    }
+
+    double totalWallMs() const {
+        double total = 0;
+        for (const auto& phase : phases) total += phase.wallMs;
+        return total;
+    }
+
+    void print(std::ostream& out) const {
+        out << std::left << std::setw(12) << "PHASE" << std::right << std::setw(12) << "WALL ms"
+            << std::setw(12) << "CPU ms" << std::setw(14) << "BYTES" << std::setw(10) << "MB/s" << '\n';
+        out << std::fixed << std::setprecision(2);
+        double totalCpu = 0;
+        for (const auto& phase : phases) {
+            out << std::left << std::setw(12) << phase.name << std::right << std::setw(12) << phase.wallMs
+                << std::setw(12) << phase.cpuMs << std::setw(14) << phase.bytes << std::setw(10);
+            if (phase.bytes && phase.wallMs > 0) {
+                out << phase.bytes / (phase.wallMs * 1000);
+            } else {
+                out << "-";
+            }
+            out << '\n';
+            totalCpu += phase.cpuMs;
+        }
+        out << std::left << std::setw(12) << "total" << std::right << std::setw(12) << totalWallMs()
+            << std::setw(12) << totalCpu << '\n';
+        out.unsetf(std::ios::floatfield);
+    }
+
+private:
+    std::vector<Phase> phases;
+
+    static double cpuNowMs() {
+        timespec now{};
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+        return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+    }
+};
+
+/*
+ * MetricsExporter Class: Writes metrics in the Prometheus text exposition
+ * format. Operation latencies and counters accumulate here; state such as
+ * sizes and pool counters is sampled by the caller on every export. The file is replaced atomically
+ * (temporary file + rename) so a scraper never reads a partial file.
+ */
+class MetricsExporter {
+public:
+    // Upper bounds of the latency histogram buckets, in seconds
+    static constexpr double LATENCY_BUCKETS[] = {0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+    static constexpr size_t BUCKET_COUNT = std::size(LATENCY_BUCKETS);
+
+    struct Sample {
+        std::string name;
+        const char* type;       // "gauge" or "counter"
+        std::string help;
+        std::string labels;     // e.g. structure="contacts", or empty
+        double value;
+    };
+
+    void observe(const OperationTrace& trace, bool slow) {
+        Operation& operation = operations[trace.getOperation()];
+        double seconds = trace.elapsedMs() / 1000;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            if (seconds <= LATENCY_BUCKETS[i]) ++operation.buckets[i];
+        }
+        ++operation.count;
+        operation.sumSeconds += seconds;
+        operation.allocations += trace.allocations();
+        if (slow) ++operation.slow;
+    }
+
+    bool write(const std::string& path, const std::vector<Sample>& samples) const {
+        return writeFile(path, render(samples));
+    }
+
+    // Writes text to path through a temporary file, so readers never see half of it
+    static bool writeFile(const std::string& path, const std::string& text) {
+        const std::string tempPath = path + ".tmp";
+        std::ofstream outFile(tempPath, std::ios::trunc);
+        outFile << text;
+        outFile.close();
+        if (!outFile || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // The samples and the per-operation histograms in Prometheus text format
+    std::string render(const std::vector<Sample>& samples) const {
+        std::ostringstream outFile;
+        outFile << std::setprecision(15);
+
+        std::string family;
+        for (const auto& sample : samples) {
+            if (sample.name != family) {
+                family = sample.name;
+                outFile << "# HELP " << sample.name << ' ' << sample.help
+                        << "\n# TYPE " << sample.name << ' ' << sample.type << '\n';
+            }
+            outFile << sample.name << (sample.labels.empty() ? "" : "{" + sample.labels + "}") << ' ' << sample.value << '\n';
+        }
+
+        outFile << "# HELP contactbook_operation_duration_seconds Latency of contact book operations.\n"
+                << "# TYPE contactbook_operation_duration_seconds histogram\n";
+        for (const auto& [name, operation] : operations) {
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                outFile << "contactbook_operation_duration_seconds_bucket{operation=\"" << name
+                        << "\",le=\"" << LATENCY_BUCKETS[i] << "\"} " << operation.buckets[i] << '\n';
+            }
+            outFile << "contactbook_operation_duration_seconds_bucket{operation=\"" << name << "\",le=\"+Inf\"} "
+                    << operation.count << '\n'
+                    << "contactbook_operation_duration_seconds_sum{operation=\"" << name << "\"} "
+                    << operation.sumSeconds << '\n'
+                    << "contactbook_operation_duration_seconds_count{operation=\"" << name << "\"} "
+                    << operation.count << '\n';
+        }
+        writeCounter(outFile, "contactbook_slow_operations_total", "Operations over the slow operation threshold.",
+                     &Operation::slow);
+        writeCounter(outFile, "contactbook_operation_allocations_total", "Memory allocations made by operations.",
+                     &Operation::allocations);
+        outFile << "# HELP contactbook_allocations_total Memory allocations made by the process.\n"
+                << "# TYPE contactbook_allocations_total counter\n"
+                << "contactbook_allocations_total " << allocationCount.load(std::memory_order_relaxed) << '\n';
+        return outFile.str();
+    }
+
+private:
+    struct Operation {
+        std::array<uint64_t, BUCKET_COUNT> buckets{};   // Cumulative, as exposed
+        uint64_t count = 0;
+        double sumSeconds = 0;
+        uint64_t allocations = 0;
+        uint64_t slow = 0;
+    };
+    std::map<std::string, Operation> operations;
+
+    void writeCounter(std::ostream& out, const char* name, const char* help, uint64_t Operation::*field) const {
+        out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " counter\n";
+        for (const auto& [operationName, operation] : operations) {
+            out << name << "{operation=\"" << operationName << "\"} " << operation.*field << '\n';
+        }
+    }
+};
+
+/*
+ * SessionRecording Class: Recorded input sessions for --record/--replay.
+ * Each line of a recording is "<ms>\t<kind>\t<input line>" where kind is
+ * "line" or "pause".
+ */
+class SessionRecording {
+public:
+    static std::optional<std::deque<InputRecord>> load(const std::string& path) {
+        std::ifstream inFile(path);
+        if (!inFile) {
+            std::cerr << "Error: Unable to open recording '" << path << "'.\n";
+            return std::nullopt;
+        }
+        std::deque<InputRecord> records;
+        std::string line;
+        for (size_t number = 1; std::getline(inFile, line); ++number) {
+            size_t first = line.find('\t');
+            size_t second = first == std::string::npos ? first : line.find('\t', first + 1);
+            std::string kind = second == std::string::npos ? "" : line.substr(first + 1, second - first - 1);
+            if (first == 0 || second == std::string::npos || (kind != "line" && kind != "pause") ||
+                !std::all_of(line.begin(), line.begin() + first, [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+                std::cerr << "Error: Malformed entry on line " << number << " of '" << path << "'.\n";
+                return std::nullopt;
+            }
+            records.push_back({std::stoll(line.substr(0, first)),
+                               kind == "pause" ? InputKind::Pause : InputKind::Line, line.substr(second + 1)});
+        }
+        return records;
+    }
+};
+
+/*
+ * OperationTimings Class: Wall time per menu operation, reported after a
+ * replayed session
+ */
+class OperationTimings {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void add(const std::string& operation, Clock::duration elapsed) {
+        Entry& entry = entries[operation];
+        double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+        ++entry.count;
+        entry.totalMs += ms;
+        entry.maxMs = std::max(entry.maxMs, ms);
+    }
+
+    void print(std::ostream& out) const {
+        out << std::left << std::setw(20) << "OPERATION" << std::right << std::setw(8) << "COUNT"
+            << std::setw(12) << "TOTAL ms" << std::setw(12) << "MEAN ms" << std::setw(12) << "MAX ms" << '\n';
+        out << std::fixed << std::setprecision(2);
+        for (const auto& [operation, entry] : entries) {
+            out << std::left << std::setw(20) << operation << std::right << std::setw(8) << entry.count
+                << std::setw(12) << entry.totalMs << std::setw(12) << entry.totalMs / entry.count
+                << std::setw(12) << entry.maxMs << '\n';
+        }
+        out.unsetf(std::ios::floatfield);
+    }
+
+private:
+    struct Entry {
+        size_t count = 0;
+        double totalMs = 0;
+        double maxMs = 0;
+    };
+    std::map<std::string, Entry> entries;
+};
+
+// Counters of the memory-limit mode
+struct EvictionStats {
+    uint64_t evictions = 0;             // Bodies moved to the spill file
+    uint64_t reloads = 0;               // Bodies made resident again on access
+    std::atomic<uint64_t> spillReads{0};    // Bodies read for scans without reloading
+    uint64_t spillWriteErrors = 0;
+};
+
+/*
+ * SpillFile Class: Append-only file holding evicted contact bodies. Each
+ * record is three 32-bit lengths followed by the name, email and address.
+ * The file is unlinked as soon as it is created, so it never outlives the
+ * process. Appends happen on the event loop thread; reads use pread and are
+ * safe from any thread.
+ */
+class SpillFile {
+public:
+    SpillFile() = default;
+    ~SpillFile() { if (fd >= 0) close(fd); }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool open() {
+        if (fd >= 0) return true;
+        const char* directory = std::getenv("TMPDIR");
+        std::string pattern = std::string(directory && *directory ? directory : "/tmp") + "/contact_book_spill_XXXXXX";
+        fd = mkstemp(pattern.data());
+        if (fd < 0) return false;
+        unlink(pattern.c_str());
+        return true;
+    }
+
+    uint64_t bytes() const { return size; }
+
+    // Appends the body of contact; returns false on a write error
+    bool append(const Contact& contact, uint64_t& offset) {
+        const std::string* fields[3] = {&contact.getName(), &contact.getEmail(), &contact.getAddress()};
+        std::string record(HEADER_SIZE, '\0');
+        for (size_t i = 0; i < 3; ++i) {
+            uint32_t length = static_cast<uint32_t>(fields[i]->size());
+            std::memcpy(&record[i * sizeof(uint32_t)], &length, sizeof(length));
+        }
+        for (const auto* field : fields) record += *field;
+
+        if (!writeAll(record.data(), record.size(), size)) return false;
+        offset = size;
+        size += record.size();
+        return true;
+    }
+
+    // Reads back a body written by append(); throws on an I/O error
+    void read(uint64_t offset, std::string& name, std::string& email, std::string& address) const {
+        uint32_t lengths[3];
+        readAll(lengths, HEADER_SIZE, offset);
+        std::string* fields[3] = {&name, &email, &address};
+        offset += HEADER_SIZE;
+        for (size_t i = 0; i < 3; ++i) {
+            fields[i]->resize(lengths[i]);
+            readAll(fields[i]->data(), lengths[i], offset);
+            offset += lengths[i];
+        }
+    }
+
+    struct Body {
+        std::string name;
+        std::string email;
+        std::string address;
+    };
+
+    // Reads many bodies in two rounds, each with all of its reads in flight
+    // at once: first the length headers, then the fields
+    std::vector<Body> readBatch(ThreadPool& pool, const std::vector<uint64_t>& offsets) const {
+        std::vector<Body> bodies(offsets.size());
+        std::vector<std::array<uint32_t, 3>> lengths(offsets.size());
+        std::vector<std::string> records(offsets.size());
+        std::vector<AsyncIo::Ticket> tickets(offsets.size());
+        AsyncIo io(pool);
+
+        for (size_t i = 0; i < offsets.size(); ++i) tickets[i] = io.read(fd, lengths[i].data(), HEADER_SIZE, offsets[i]);
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            if (io.wait(tickets[i]) != static_cast<int64_t>(HEADER_SIZE)) throw std::runtime_error("spill file read failed");
+        }
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            records[i].resize(size_t(lengths[i][0]) + lengths[i][1] + lengths[i][2]);
+            tickets[i] = io.read(fd, records[i].data(), records[i].size(), offsets[i] + HEADER_SIZE);
+        }
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            if (io.wait(tickets[i]) != static_cast<int64_t>(records[i].size())) throw std::runtime_error("spill file read failed");
+            bodies[i].name.assign(records[i], 0, lengths[i][0]);
+            bodies[i].email.assign(records[i], lengths[i][0], lengths[i][1]);
+            bodies[i].address.assign(records[i], size_t(lengths[i][0]) + lengths[i][1], lengths[i][2]);
+        }
+        return bodies;
+    }
+
+    // Forgets every record; offsets handed out earlier become invalid
+    void clear() {
+        if (fd >= 0 && ftruncate(fd, 0) != 0) return;
+        size = 0;
+    }
+
+private:
+    static constexpr size_t HEADER_SIZE = 3 * sizeof(uint32_t);
+    int fd = -1;
+    uint64_t size = 0;
+
+    bool writeAll(const char* data, size_t length, uint64_t offset) const {
+        while (length > 0) {
+            ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+            data += written;
+            length -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    void readAll(void* buffer, size_t length, uint64_t offset) const {
+        char* data = static_cast<char*>(buffer);
+        while (length > 0) {
+            ssize_t got = pread(fd, data, length, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) throw std::runtime_error("spill file read failed");
+            data += got;
+            length -= static_cast<size_t>(got);
+            offset += static_cast<uint64_t>(got);
+        }
+    }
+};
+
+/*
+ * SlotFile Class: Fixed-size contact records for --slot-file. After a
+ * 64-byte header, contact i occupies the slotSize bytes at
+ * HEADER_SIZE + i * slotSize, so any record can be read or rewritten in
+ * place with a single pread/pwrite, and disjoint ranges can be read or
+ * written from several threads at once.
+ *
+ * A record is tagged so fields can be added without rewriting old files:
+ * a schema version byte, the number of fields, one tag byte per field, a
+ * 16-bit length per field and then the field bytes. Readers skip tags they
+ * do not know and leave fields without a tag empty. Records in the current
+ * layout (all FIELD_TAGS in order) are decoded by a fixed loop instead.
+ * The last four bytes of a slot are a CRC-32C of the rest, and the header
+ * carries its own CRC-32C. Numbers use host byte order.
+ *
+ * Deleting a contact overwrites its slot with a free record (schema
+ * version FREE_RECORD, no fields) instead of moving the slots after it, so
+ * slots stay in list order but may have gaps. Readers skip free records.
+ * Files that may hold free records carry a newer MAGIC than the versions
+ * that did not know them, so those refuse the file instead of reading free
+ * slots as empty contacts; their files are upgraded when opened.
+ */
+class SlotFile {
+public:
+    static constexpr size_t FIELD_COUNT = 5;    // Name, phone, email, address, birthdate
+    static constexpr uint8_t FIELD_TAGS[FIELD_COUNT] = {1, 2, 3, 4, 5};
+    static constexpr size_t FIELD_MAX_LENGTHS[FIELD_COUNT] = {
+        InputValidator::MAX_TEXT_LENGTH, 11, InputValidator::MAX_TEXT_LENGTH, InputValidator::MAX_TEXT_LENGTH, 10
+    };
+    static constexpr uint8_t RECORD_VERSION = 1;
+    static constexpr uint8_t FREE_RECORD = 0;      // Version byte of a deleted slot
+    static constexpr size_t HEADER_SIZE = 64;
+    // Slot size of new files: room for every field at its longest
+    static constexpr size_t SLOT_SIZE = (2 + 3 * FIELD_COUNT + FIELD_MAX_LENGTHS[0] + FIELD_MAX_LENGTHS[1] +
+                                         FIELD_MAX_LENGTHS[2] + FIELD_MAX_LENGTHS[3] + FIELD_MAX_LENGTHS[4] +
+                                         sizeof(uint32_t) + 7) / 8 * 8;
+
+    SlotFile() = default;
+    ~SlotFile() { if (fd >= 0) close(fd); }
+
+    SlotFile(const SlotFile&) = delete;
+    SlotFile& operator=(const SlotFile&) = delete;
+
+    // Opens path, creating an empty slot file if it does not exist. An
+    // existing file keeps its own slot size.
+    bool open(const std::string& path) {
+        this->path = path;
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            std::cerr << "Error: Unable to open slot file '" << path << "': " << std::strerror(errno) << "\n";
+            return false;
+        }
+        off_t fileSize = lseek(fd, 0, SEEK_END);
+        if (fileSize == 0) return writeHeader();
+
+        char header[HEADER_SIZE] = {};
+        uint32_t size = 0;
+        uint32_t checksum = 0;
+        bool ok = fileSize >= static_cast<off_t>(HEADER_SIZE) && readAll(header, HEADER_SIZE, 0);
+        if (ok) {
+            std::memcpy(&size, header + 8, sizeof(size));
+            std::memcpy(&slotCount, header + 16, sizeof(slotCount));
+            std::memcpy(&checksum, header + HEADER_CHECKSUM_OFFSET, sizeof(checksum));
+        }
+        bool legacy = ok && std::memcmp(header, LEGACY_MAGIC, 8) == 0;
+        if (!ok || (!legacy && std::memcmp(header, MAGIC, 8) != 0)) {
+            std::cerr << "Error: '" << path << "' is not a contact slot file of this version.\n";
+            return false;
+        }
+        if (checksum != Crc32c::compute(header, HEADER_CHECKSUM_OFFSET)) {
+            std::cerr << "Error: The header of slot file '" << path << "' fails its checksum.\n";
+            return false;
+        }
+        if (size < MIN_SLOT_SIZE || size > MAX_SLOT_SIZE) {
+            std::cerr << "Error: Slot file '" << path << "' has an unsupported slot size of " << size << " bytes.\n";
+            return false;
+        }
+        slotSize = size;
+        if (slotCount > (static_cast<uint64_t>(fileSize) - HEADER_SIZE) / slotSize) {
+            std::cerr << "Error: Slot file '" << path << "' is truncated.\n";
+            return false;
+        }
+        return !legacy || writeHeader();
+    }
+
+    const std::string& getPath() const { return path; }
+    size_t count() const { return slotCount; }
+    size_t getSlotSize() const { return slotSize; }
+    uint64_t offsetOf(size_t slot) const { return HEADER_SIZE + static_cast<uint64_t>(slot) * slotSize; }
+
+    // Whether contact fits in one slot of this file
+    bool fits(const Contact& contact) const {
+        size_t length = 2 + 3 * FIELD_COUNT + sizeof(uint32_t);
+        for (const std::string* field : fieldsOf(contact)) {
+            if (field->size() > UINT16_MAX) return false;
+            length += field->size();
+        }
+        return length <= slotSize;
+    }
+
+    // Writes contact into slot, which may be the first slot past the end
+    bool write(size_t slot, const Contact& contact) {
+        std::vector<char> record(slotSize);
+        encode(contact, record.data());
+        if (!writeAll(record.data(), slotSize, offsetOf(slot))) return false;
+        return slot < slotCount || resize(slot + 1);
+    }
+
+    // Writes contacts [begin, end) of rows into the matching slots; the
+    // count is not changed, so callers writing in parallel call resize()
+    template<typename Rows>
+    bool writeRange(const Rows& rows, size_t begin, size_t end) {
+        std::vector<char> buffer((end - begin) * slotSize);
+        for (size_t i = begin; i < end; ++i) encode(rows[i], &buffer[(i - begin) * slotSize]);
+        return writeAll(buffer.data(), buffer.size(), offsetOf(begin));
+    }
+
+    // Reads the contacts in slots [begin, end) into out, each with its slot
+    // number; false on an I/O error. Free slots are skipped. Slots that fail
+    // their checksum or do not decode are appended to corrupt and read as
+    // empty contacts.
+    bool readRange(size_t begin, size_t end, std::vector<Contact>& out, std::vector<size_t>& corrupt) const {
+        std::vector<char> buffer((end - begin) * slotSize);
+        if (!readAll(buffer.data(), buffer.size(), offsetOf(begin))) return false;
+        out.reserve(out.size() + (end - begin));
+        for (size_t i = 0; i < end - begin; ++i) {
+            const char* record = &buffer[i * slotSize];
+            uint32_t checksum;
+            std::memcpy(&checksum, record + slotSize - sizeof(checksum), sizeof(checksum));
+            std::string fields[FIELD_COUNT];
+            if (checksum != Crc32c::compute(record, slotSize - sizeof(checksum)) || !decode(record, fields)) {
+                corrupt.push_back(begin + i);
+                out.emplace_back();
+            } else if (static_cast<uint8_t>(record[0]) == FREE_RECORD) {
+                continue;
+            } else {
+                out.emplace_back(fields[0], fields[1], fields[2], fields[3], fields[4]);
+            }
+            out.back().setSlot(begin + i);
+        }
+        return true;
+    }
+
+    // Frees slot with a single write; the last slot is truncated away instead
+    bool erase(size_t slot) {
+        if (slot + 1 == slotCount) return resize(slot);
+        std::vector<char> record(slotSize, 0);
+        record[0] = static_cast<char>(FREE_RECORD);
+        uint32_t checksum = Crc32c::compute(record.data(), slotSize - sizeof(checksum));
+        std::memcpy(&record[slotSize - sizeof(checksum)], &checksum, sizeof(checksum));
+        return writeAll(record.data(), slotSize, offsetOf(slot));
+    }
+
+    // Sets the number of slots, truncating the file to match
+    bool resize(size_t count) {
+        slotCount = count;
+        return writeHeader() && ftruncate(fd, static_cast<off_t>(offsetOf(count))) == 0;
+    }
+
+private:
+    static constexpr char MAGIC[8] = {'C', 'B', 'S', 'L', 'O', 'T', 'S', '4'};
+    static constexpr char LEGACY_MAGIC[8] = {'C', 'B', 'S', 'L', 'O', 'T', 'S', '3'};   // No free records
+    static constexpr size_t HEADER_CHECKSUM_OFFSET = 24;
+    static constexpr size_t MIN_SLOT_SIZE = 2 + sizeof(uint32_t);
+    static constexpr size_t MAX_SLOT_SIZE = 1 << 20;
+    std::string path;
+    int fd = -1;
+    size_t slotSize = SLOT_SIZE;
+    uint64_t slotCount = 0;
+
+    static std::array<const std::string*, FIELD_COUNT> fieldsOf(const Contact& contact) {
+        return {&contact.getName(), &contact.getPhoneNumber(), &contact.getEmail(), &contact.getAddress(), &contact.getBirthdate()};
+    }
+
+    // Callers check fits() first; the record is always in the current layout
+    void encode(const Contact& contact, char* record) const {
+        std::memset(record, 0, slotSize);
+        record[0] = static_cast<char>(RECORD_VERSION);
+        record[1] = static_cast<char>(FIELD_COUNT);
+        std::memcpy(record + 2, FIELD_TAGS, FIELD_COUNT);
+        char* length = record + 2 + FIELD_COUNT;
+        char* field = length + 2 * FIELD_COUNT;
+        for (const std::string* value : fieldsOf(contact)) {
+            uint16_t size = static_cast<uint16_t>(value->size());
+            std::memcpy(length, &size, sizeof(size));
+            std::memcpy(field, value->data(), size);
+            length += sizeof(size);
+            field += size;
+        }
+        uint32_t checksum = Crc32c::compute(record, slotSize - sizeof(checksum));
+        std::memcpy(record + slotSize - sizeof(checksum), &checksum, sizeof(checksum));
+    }
+
+    // Fills fields from record; false if its directory does not fit the slot
+    bool decode(const char* record, std::string (&fields)[FIELD_COUNT]) const {
+        const size_t capacity = slotSize - sizeof(uint32_t);
+        const size_t count = static_cast<unsigned char>(record[1]);
+        const char* tags = record + 2;
+        const char* lengths = tags + count;
+        const char* field = lengths + 2 * count;
+        if (static_cast<size_t>(field - record) > capacity) return false;
+        uint16_t sizes[UINT8_MAX];
+        std::memcpy(sizes, lengths, 2 * count);
+        size_t total = 0;
+        for (size_t f = 0; f < count; ++f) total += sizes[f];
+        if (static_cast<size_t>(field - record) + total > capacity) return false;
+
+        if (static_cast<uint8_t>(record[0]) == RECORD_VERSION && count == FIELD_COUNT &&
+            std::memcmp(tags, FIELD_TAGS, FIELD_COUNT) == 0) {
+            for (size_t f = 0; f < FIELD_COUNT; ++f) {
+                fields[f].assign(field, sizes[f]);
+                field += sizes[f];
+            }
+            return true;
+        }
+
+        // Other versions: match fields by tag, skipping unknown ones
+        for (size_t f = 0; f < count; ++f) {
+            const uint8_t* known = std::find(FIELD_TAGS, FIELD_TAGS + FIELD_COUNT, static_cast<uint8_t>(tags[f]));
+            if (known != FIELD_TAGS + FIELD_COUNT) fields[known - FIELD_TAGS].assign(field, sizes[f]);
+            field += sizes[f];
+        }
+        return true;
+    }
+
+    bool writeHeader() {
+        char header[HEADER_SIZE] = {};
+        uint32_t size = static_cast<uint32_t>(slotSize);
+        uint32_t version = RECORD_VERSION;
+        std::memcpy(header, MAGIC, 8);
+        std::memcpy(header + 8, &size, sizeof(size));
+        std::memcpy(header + 12, &version, sizeof(version));  // Newest record version written; informational
+        std::memcpy(header + 16, &slotCount, sizeof(slotCount));
+        uint32_t checksum = Crc32c::compute(header, HEADER_CHECKSUM_OFFSET);
+        std::memcpy(header + HEADER_CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+        return writeAll(header, HEADER_SIZE, 0);
+    }
+
+    bool writeAll(const char* data, size_t length, uint64_t offset) const {
+        while (length > 0) {
+            ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+            data += written;
+            length -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    bool readAll(char* data, size_t length, uint64_t offset) const {
+        while (length > 0) {
+            ssize_t got = pread(fd, data, length, static_cast<off_t>(offset));
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            data += got;
+            length -= static_cast<size_t>(got);
+            offset += static_cast<uint64_t>(got);
+        }
+        return true;
+    }
+};
+
+/*
+ * ContactBook Class: Manages the entire contact book operations
+ */
+class ContactBook {
+private:
+    std::vector<Contact> contacts;
+    mutable EventLoop loop;             // Drives terminal input, timers and completions
+    mutable ThreadPool pool;            // Shared by all parallel operations
+    mutable CancellationToken cancellation; // Cancels the running long operation
+    ContactIndex index;                 // Lock-free name and phone lookups
+    std::unordered_map<uint64_t, size_t> positionById;
+    uint64_t nextContactId = 1;
+    BirthdayScheduler birthdays;        // Birthday reminders on a timer wheel
+    ContactStatistics statistics;       // Incrementally maintained aggregates
+    std::unique_ptr<ImportSketches> lastImport; // Sketches from the latest load
+    mutable ColumnStore columns;        // Packed numeric fields for filters
+    SavedSearches savedSearches;        // Materialized named filters
+    LocalityIndex localities;           // Contact ids by city and province
+    std::vector<ContactObserver*> observers;
+    std::ofstream sessionRecording;     // Input log written with --record
+    int64_t replayedSessionMs = 0;      // Length of the session being replayed
+    OperationTimings operationTimings;  // Per-operation wall time during a replay
+    SlowOperationLog slowOperations;    // Operations over the latency threshold
+    mutable MetricsExporter metrics;    // Latency histograms and counters
+    size_t memoryLimit = 0;             // Budget for resident contact bodies in bytes, 0 if unlimited
+    size_t residentBodyBytes = 0;       // Heap bytes of names, emails and addresses in memory
+    size_t fieldBytes = 0;              // Heap bytes of the other fields, never evicted
+    size_t evictedContacts = 0;
+    uint64_t accessClock = 0;           // Source of Contact::lastAccess ticks
+    std::set<std::pair<uint64_t, uint64_t>> residentByAccess;  // (last access, id) of resident bodies, only with a limit
+    size_t evictedSinceTrim = 0;        // Body bytes evicted since the heap was last trimmed
+    SpillFile spill;                    // Evicted contact bodies
+    mutable EvictionStats evictionStats;
+    std::unique_ptr<SlotFile> slots;    // Fixed-size copy of the book, null unless --slot-file
+    std::optional<SealedBlocks::Key> encryptionKey;     // contacts.txt is saved sealed when set
+    std::string metricsPath;            // Prometheus text file, empty if disabled
+    mutable std::future<void> metricsWrite;     // Background write of the metrics file, if started
+
+    // Fraction of the memory limit that eviction brings resident bodies down to
+    static constexpr double EVICTION_TARGET = 0.9;
+
+    // Evicted body bytes after which freed pages are handed back to the system
+    static constexpr size_t TRIM_AFTER_BYTES = size_t(8) << 20;
+
+    // Contacts per task when an operation is split across the pool
+    static constexpr size_t PARALLEL_CHUNK_SIZE = 4096;
+
+    // Bytes read from disk per streaming load step
+    static constexpr size_t LOAD_BLOCK_SIZE = size_t(4) << 20;
+
+    // Blocks read ahead of the one being parsed during a load
+    static constexpr size_t LOAD_READ_AHEAD = 4;
+
+    // Failed checksum blocks listed when a file is rejected
+    static constexpr size_t MAX_REPORTED_CORRUPTIONS = 10;
+
+    // Records listed when a loaded file has records that fail validation
+    static constexpr size_t MAX_REPORTED_INVALID = 5;
+
+    // Chunks formatted per save batch, each written from its own buffer
+    static constexpr size_t SAVE_BATCH_CHUNKS = 16;
+
+    // Rows shown per category on the statistics screen
+    static constexpr size_t STATISTICS_TOP_ENTRIES = 10;
+
+    /*
+     * All changes to the contact list go through the helpers below so that
+     * the lookup indexes stay in sync; each helper publishes one batch.
+     */
+    void insertContact(Contact contact) {
+        Gazetteer::annotate(contact);
+        contact.setId(nextContactId++);
+        contact.setVersion(1);
+        contact.setLastAccess(++accessClock);
+        residentBodyBytes += bodyBytes(contact);
+        fieldBytes += otherFieldBytes(contact);
+        positionById[contact.getId()] = contacts.size();
+        if (slots) contact.setSlot(slots->count());     // Appended after the last slot
+        index.stageInsert(contact);
+        contacts.push_back(std::move(contact));
+        trackResident(contacts.back());
+        writeSlot(contacts.size() - 1);
+        index.publish();
+        for (auto* observer : observers) observer->onContactAdded(contacts.back());
+        enforceMemoryLimit();
+    }
+
+    void eraseContactAt(size_t position) {
+        touch(position);    // Observers and the index need the full body
+        untrackResident(contacts[position]);
+        residentBodyBytes -= bodyBytes(contacts[position]);
+        fieldBytes -= otherFieldBytes(contacts[position]);
+        Contact removed = std::move(contacts[position]);
+        index.stageRemove(removed);
+        positionById.erase(removed.getId());
+        contacts.erase(contacts.begin() + position);
+        for (size_t i = position; i < contacts.size(); ++i) {
+            positionById[contacts[i].getId()] = i;
+        }
+        if (slots && !slots->erase(removed.getSlot())) detachSlots(std::strerror(errno));
+        compactSlotsIfSparse();
+        index.publish();
+        for (auto* observer : observers) observer->onContactRemoved(removed);
+    }
+
+    // Replaces the contact at position, keeping its id and bumping its version
+    void replaceContactAt(size_t position, Contact updated) {
+        touch(position);
+        Gazetteer::annotate(updated);
+        updated.setId(contacts[position].getId());
+        updated.setVersion(contacts[position].getVersion() + 1);
+        updated.setLastAccess(contacts[position].getLastAccess());
+        updated.setSlot(contacts[position].getSlot());
+        untrackResident(contacts[position]);
+        residentBodyBytes -= bodyBytes(contacts[position]);
+        residentBodyBytes += bodyBytes(updated);
+        fieldBytes -= otherFieldBytes(contacts[position]);
+        fieldBytes += otherFieldBytes(updated);
+        index.stageRemove(contacts[position]);
+        index.stageInsert(updated);
+        Contact before = std::exchange(contacts[position], std::move(updated));
+        trackResident(contacts[position]);
+        writeSlot(position);    // Rewritten in place
+        index.publish();
+        for (auto* observer : observers) observer->onContactModified(before, contacts[position]);
+        enforceMemoryLimit();
+    }
+
+    void replaceAllContacts(std::vector<Contact> loaded, StartupProfile& profile) {
+        contacts = std::move(loaded);
+        {
+            auto phase = profile.measure("annotate");
+            pool.parallelFor(contacts.size(), PARALLEL_CHUNK_SIZE, [this](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) Gazetteer::annotate(contacts[i]);
+            });
+        }
+        {
+            auto phase = profile.measure("index");
+            positionById.clear();
+            index.stageClear();
+            spill.clear();
+            residentBodyBytes = 0;
+            fieldBytes = 0;
+            evictedContacts = 0;
+            residentByAccess.clear();
+            for (size_t i = 0; i < contacts.size(); ++i) {
+                contacts[i].setId(nextContactId++);
+                contacts[i].setVersion(1);
+                contacts[i].setLastAccess(++accessClock);
+                residentBodyBytes += bodyBytes(contacts[i]);
+                fieldBytes += otherFieldBytes(contacts[i]);
+                positionById[contacts[i].getId()] = i;
+                index.stageInsert(contacts[i]);
+                trackResident(contacts[i]);
+            }
+            index.publish();
+        }
+        {
+            auto phase = profile.measure("observers");
+            for (auto* observer : observers) observer->onContactsReloaded(contacts);
+        }
+        if (slots) {
+            auto phase = profile.measure("slots");
+            writeAllSlots();
+        }
+        auto phase = profile.measure("evict");
+        enforceMemoryLimit();
+    }
+
+    /*
+     * Slot file (--slot-file): every change is written through to the
+     * contact's own slot (Contact::getSlot), so an add, modify or delete
+     * costs one or two slot writes. Deletes leave free slots behind; once
+     * they outnumber the contacts, the file is rewritten without them.
+     * After a write error, or a contact too long for a slot, the file is
+     * detached and no longer updated.
+     */
+    void writeSlot(size_t position) {
+        if (!slots) return;
+        Contact scratch;
+        const Contact& contact = bodyAt(position, scratch);
+        if (!slots->fits(contact)) {
+            detachSlots("a contact is too long for a slot");
+        } else if (!slots->write(contact.getSlot(), contact)) {
+            detachSlots(std::strerror(errno));
+        }
+    }
+
+    void compactSlotsIfSparse() {
+        if (slots && slots->count() - contacts.size() > std::max(contacts.size(), PARALLEL_CHUNK_SIZE)) writeAllSlots();
+    }
+
+    // Rewrites every slot from the book, one chunk per task; slot i then holds contacts[i]
+    void writeAllSlots() {
+        if (!slots) return;
+        for (size_t i = 0; i < contacts.size(); ++i) contacts[i].setSlot(i);
+        std::atomic<bool> tooLong{false}, failed{false};
+        pool.parallelFor(contacts.size(), PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            auto writeChunk = [&](const auto& rows) {
+                for (size_t i = begin; i < end; ++i) {
+                    if (!slots->fits(rows[i])) {
+                        tooLong = true;
+                        return;
+                    }
+                }
+                if (!slots->writeRange(rows, begin, end)) failed = true;
+            };
+            if (evictedContacts == 0) {
+                writeChunk(contacts);
+            } else {
+                writeChunk(BodyView{*this});
+            }
+        });
+        if (tooLong) {
+            detachSlots("a contact is too long for a slot");
+        } else if (failed || !slots->resize(contacts.size())) {
+            detachSlots("write failed");
+        }
+    }
+
+    void detachSlots(const std::string& reason) {
+        std::cerr << "Error: Unable to update slot file '" << slots->getPath() << "' (" << reason
+                  << "); it will no longer be kept up to date.\n";
+        slots.reset();
+    }
+
+    // Reads every slot of file, one chunk per task
+    bool readSlotFile(const SlotFile& file, std::vector<Contact>& loaded, ImportSketches& sketches,
+                      StartupProfile& profile) const {
+        size_t count = file.count();
+        size_t chunkCount = (count + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+        std::vector<std::vector<Contact>> chunkContacts(chunkCount);
+        std::vector<ImportSketches> chunkSketches(chunkCount);
+        std::vector<std::vector<size_t>> chunkCorrupt(chunkCount);
+        std::atomic<bool> failed{false};
+        pool.parallelFor(count, PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            auto& parsed = chunkContacts[begin / PARALLEL_CHUNK_SIZE];
+            if (!file.readRange(begin, end, parsed, chunkCorrupt[begin / PARALLEL_CHUNK_SIZE])) {
+                failed = true;
+                return;
+            }
+            for (const auto& contact : parsed) chunkSketches[begin / PARALLEL_CHUNK_SIZE].add(contact);
+        });
+        if (failed) {
+            std::cerr << "Error: Unable to read contacts from slot file '" << file.getPath() << "'.\n";
+            return false;
+        }
+
+        // Runs of consecutive corrupt slots, reported as 1-based record ranges
+        std::vector<std::pair<size_t, size_t>> corrupt;
+        for (const auto& slots : chunkCorrupt) {
+            for (size_t slot : slots) {
+                if (!corrupt.empty() && corrupt.back().second + 1 == slot) {
+                    corrupt.back().second = slot;
+                } else {
+                    corrupt.emplace_back(slot, slot);
+                }
+            }
+        }
+        if (!corrupt.empty()) {
+            std::cerr << "Error: Slot file '" << file.getPath() << "' failed its integrity check.\n";
+            for (size_t i = 0; i < std::min(corrupt.size(), MAX_REPORTED_CORRUPTIONS); ++i) {
+                auto [first, last] = corrupt[i];
+                std::cerr << "  records " << first + 1 << "-" << last + 1 << " (bytes "
+                          << file.offsetOf(first) << "-" << file.offsetOf(last + 1) << ") fail their checksum\n";
+            }
+            if (corrupt.size() > MAX_REPORTED_CORRUPTIONS) {
+                std::cerr << "  ... and " << corrupt.size() - MAX_REPORTED_CORRUPTIONS << " more\n";
+            }
+            return false;
+        }
+        loaded.reserve(count);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            std::move(chunkContacts[chunk].begin(), chunkContacts[chunk].end(), std::back_inserter(loaded));
+            sketches.merge(chunkSketches[chunk]);
+        }
+        reportInvalidRecords(loaded, file.getPath(), profile);
+        return true;
+    }
+
+    /*
+     * Load-time validation: checks loaded records chunk by chunk on the pool
+     * with BatchValidator and warns about records the menus would not
+     * accept. They are kept as they are, so older or hand-edited files still
+     * load.
+     */
+    void reportInvalidRecords(const std::vector<Contact>& loaded, const std::string& source, StartupProfile& profile) const {
+        auto phase = profile.measure("validate");
+        size_t chunkCount = (loaded.size() + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+        std::vector<size_t> invalidCounts(chunkCount);
+        std::vector<std::vector<size_t>> examples(chunkCount);     // First invalid positions of each chunk
+        pool.parallelFor(loaded.size(), PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end) {
+            size_t chunk = begin / PARALLEL_CHUNK_SIZE;
+            BatchValidator::Bitmap valid = BatchValidator::validContacts(loaded, begin, end);
+            invalidCounts[chunk] = (end - begin) - FilterEngine::count(valid);
+            for (size_t i = 0; i < end - begin && examples[chunk].size() < MAX_REPORTED_INVALID; ++i) {
+                if (!(valid[i / 64] >> (i % 64) & 1)) examples[chunk].push_back(begin + i);
+            }
+        });
+
+        size_t invalid = 0;
+        for (size_t count : invalidCounts) invalid += count;
+        if (invalid == 0) return;
+        std::cerr << "Warning: " << invalid << " of " << loaded.size() << " records in '" << source
+                  << "' do not pass validation; they were loaded as they are.\n";
+        size_t reported = 0;
+        for (const auto& positions : examples) {
+            for (size_t position : positions) {
+                if (reported++ == MAX_REPORTED_INVALID) return;
+                std::cerr << "  record " << position + 1 << ": "
+                          << ErrorMessages::forError(InputValidator::check(loaded[position]), InputValidator::MAX_TEXT_LENGTH) << "\n";
+            }
+        }
+    }
+
+    /*
+     * Memory-limit mode: names, emails and addresses (the parts of a contact
+     * that live on the heap) count against memoryLimit. When they exceed
+     * it, the least recently used bodies are written to the spill file and
+     * dropped until EVICTION_TARGET of the limit is reached; ids, versions,
+     * phone numbers, birthdates, localities and every index stay in memory.
+     */
+    static size_t bodyBytes(const Contact& contact) {
+        return heapBytes(contact.getName()) + heapBytes(contact.getEmail()) + heapBytes(contact.getAddress());
+    }
+
+    // The rest of heapBytes(contact), kept as a running total for the metrics
+    static size_t otherFieldBytes(const Contact& contact) {
+        return heapBytes(contact.getPhoneNumber()) + heapBytes(contact.getBirthdate()) +
+               heapBytes(contact.getCity()) + heapBytes(contact.getProvince());
+    }
+
+    // Contact at position with its full body. An evicted body is read into
+    // scratch without becoming resident, so scans do not disturb the LRU
+    // order. Safe from pool threads.
+    const Contact& bodyAt(size_t position, Contact& scratch) const {
+        const Contact& contact = contacts[position];
+        if (!contact.isEvicted()) return contact;
+        std::string name, email, address;
+        spill.read(contact.getSpillOffset(), name, email, address);
+        scratch = contact;
+        scratch.restore(std::move(name), std::move(email), std::move(address));
+        evictionStats.spillReads.fetch_add(1, std::memory_order_relaxed);
+        return scratch;
+    }
+
+    Contact bodyCopy(size_t position) const {
+        Contact scratch;
+        return bodyAt(position, scratch);
+    }
+
+    // Full bodies of contacts [begin, end). Evicted bodies are read into
+    // restored with all of their spill reads in flight at once. Safe from
+    // pool threads.
+    std::vector<const Contact*> bodiesInRange(size_t begin, size_t end, std::vector<Contact>& restored) const {
+        std::vector<const Contact*> rows(end - begin);
+        std::vector<size_t> evicted;
+        for (size_t i = begin; i < end; ++i) {
+            rows[i - begin] = &contacts[i];
+            if (contacts[i].isEvicted()) evicted.push_back(i);
+        }
+        if (evicted.empty()) return rows;
+
+        std::vector<uint64_t> offsets;
+        for (size_t position : evicted) offsets.push_back(contacts[position].getSpillOffset());
+        std::vector<SpillFile::Body> bodies = spill.readBatch(pool, offsets);
+        restored.reserve(restored.size() + evicted.size());
+        for (size_t k = 0; k < evicted.size(); ++k) {
+            restored.push_back(contacts[evicted[k]]);
+            restored.back().restore(std::move(bodies[k].name), std::move(bodies[k].email), std::move(bodies[k].address));
+            rows[evicted[k] - begin] = &restored.back();
+        }
+        evictionStats.spillReads.fetch_add(evicted.size(), std::memory_order_relaxed);
+        return rows;
+    }
+
+    // Makes the contact at position resident and most recently used
+    void touch(size_t position) {
+        Contact& contact = contacts[position];
+        untrackResident(contact);
+        if (contact.isEvicted()) {
+            std::string name, email, address;
+            spill.read(contact.getSpillOffset(), name, email, address);
+            contact.restore(std::move(name), std::move(email), std::move(address));
+            residentBodyBytes += bodyBytes(contact);
+            --evictedContacts;
+            ++evictionStats.reloads;
+        }
+        contact.setLastAccess(++accessClock);
+        trackResident(contact);
+    }
+
+    /*
+     * residentByAccess orders the resident bodies that eviction could drop,
+     * least recently used first, so enforceMemoryLimit() takes them from
+     * the front instead of sorting the book. It is only kept while a memory
+     * limit is set; every change to a contact's body or access tick goes
+     * through untrackResident() before and trackResident() after.
+     */
+    void trackResident(const Contact& contact) {
+        if (memoryLimit != 0 && !contact.isEvicted() && bodyBytes(contact) > 0) {
+            residentByAccess.emplace(contact.getLastAccess(), contact.getId());
+        }
+    }
+
+    void untrackResident(const Contact& contact) {
+        if (memoryLimit != 0) residentByAccess.erase({contact.getLastAccess(), contact.getId()});
+    }
+
+    void enforceMemoryLimit() {
+        if (memoryLimit == 0 || residentBodyBytes <= memoryLimit) return;
+        size_t target = static_cast<size_t>(memoryLimit * EVICTION_TARGET);
+
+        while (residentBodyBytes > target && !residentByAccess.empty()) {
+            Contact& contact = contacts[positionById.at(residentByAccess.begin()->second)];
+            // A body spilled before and not changed since is still in the file
+            uint64_t offset = contact.getSpillOffset();
+            if (offset == Contact::NOT_SPILLED || contact.getSpilledVersion() != contact.getVersion()) {
+                if (!spill.append(contact, offset)) {
+                    ++evictionStats.spillWriteErrors;
+                    std::cerr << "Error: Unable to write to the spill file; memory limit not enforced.\n";
+                    break;
+                }
+            }
+            residentByAccess.erase(residentByAccess.begin());
+            residentBodyBytes -= bodyBytes(contact);
+            evictedSinceTrim += bodyBytes(contact);
+            contact.evict(offset);
+            ++evictedContacts;
+            ++evictionStats.evictions;
+        }
+        if (evictedSinceTrim >= TRIM_AFTER_BYTES) {
+            malloc_trim(0);     // Hand freed pages back to the system
+            evictedSinceTrim = 0;
+        }
+    }
+
+    // Contacts with full bodies, for code that takes a vector-like range
+    struct BodyView {
+        const ContactBook& book;
+        size_t size() const { return book.contacts.size(); }
+        Contact operator[](size_t position) const { return book.bodyCopy(position); }
+    };
+
+    // Rows [begin, end) for FilterEngine; evicted bodies are read on first use
+    struct ChunkRows {
+        const ContactBook& book;
+        size_t begin;
+        mutable std::vector<int32_t> slots;     // Index into loaded, -1 if not read
+        mutable std::deque<Contact> loaded;     // Stable references while growing
+
+        ChunkRows(const ContactBook& book, size_t begin, size_t end)
+            : book(book), begin(begin), slots(end - begin, -1) {}
+
+        const Contact& operator[](size_t row) const {
+            const Contact& contact = book.contacts[row];
+            if (!contact.isEvicted()) return contact;
+            int32_t& slot = slots[row - begin];
+            if (slot < 0) {
+                slot = static_cast<int32_t>(loaded.size());
+                loaded.push_back(book.bodyCopy(row));
+            }
+            return loaded[static_cast<size_t>(slot)];
+        }
+    };
+
+    enum class UpdateResult { Applied, Conflict, NotFound };
+
+    /*
+     * Optimistic update: applies updated only if the contact still carries
+     * expectedVersion, so edits prepared without holding anything (e.g.
+     * while the user is typing) never overwrite a newer change. Writers run
+     * on the event loop thread, so the check and the write cannot interleave
+     * with another writer.
+     */
+    UpdateResult updateContactIf(uint64_t id, uint64_t expectedVersion, Contact updated) {
+        auto it = positionById.find(id);
+        if (it == positionById.end()) return UpdateResult::NotFound;
+        if (contacts[it->second].getVersion() != expectedVersion) return UpdateResult::Conflict;
+        replaceContactAt(it->second, std::move(updated));
+        return UpdateResult::Applied;
+    }
+
+    // Position of the first contact with exactly this name
+    std::optional<size_t> findPositionByName(const std::string& name) const {
+        ContactIndex::IdList ids = index.findByName(name);
+        if (ids.empty()) return std::nullopt;
+        return positionById.at(ids.front());
+    }
+
+    // Helper function to get input
+    Task<std::string> getInput(const std::string& prompt) const {
+        std::cout << prompt;
+        co_return co_await loop.readLine();
+    }
+
+    // Waits for the user to acknowledge a message
+    Task<void> pressEnterToContinue() const {
+        std::cout << "\nPress Enter to continue...";
+        co_await loop.readLine(InputKind::Pause);
+    }
+
+    // Converts string to uppercase for case-insensitive comparisons
+    std::string toUpper(const std::string& str) const {
+        std::string upper = str;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        return upper;
+    }
+
+    // Clears the console screen for better UI
+    void clearScreen() const {
+        if (loop.isReplaying()) return;
+        #ifdef _WIN32
+            system("cls");
+        #else
             system("clear");
         #endif
     }
 
-    // Displays centered header for each menu section
-    void displayHeader(const std::string& title) const {
-        clearScreen();
-        std::cout << std::string(50, '=') << '\n';
-        std::cout << std::setw((50 + title.length()) / 2) << std::right << title << '\n';
-        std::cout << std::string(50, '=') << '\n';
+    // Displays centered header for each menu section
+    void displayHeader(const std::string& title) const {
+        clearScreen();
+        std::cout << std::string(50, '=') << '\n';
+        std::cout << std::setw((50 + title.length()) / 2) << std::right << title << '\n';
+        std::cout << std::string(50, '=') << '\n';
+    }
+
+    struct ColumnWidths {
+        size_t nameWidth = 4;      // "NAME"
+        size_t phoneWidth = 5;     // "PHONE"
+        size_t emailWidth = 5;     // "EMAIL"
+        size_t addressWidth = 7;   // "ADDRESS"
+        size_t birthdateWidth = 9; // "BIRTHDATE"
+        
+        // Add minimum padding to each column
+        static constexpr size_t MIN_PADDING = 4; // 2 spaces on each side
+        
+        void updateWidths(const Contact& contact) {
+            nameWidth = std::max(nameWidth, contact.getName().length() + MIN_PADDING);
+            // Phone number will always be in format "+63 (XXX) XXX XXXX"
+            phoneWidth = std::max(phoneWidth, size_t(20) + MIN_PADDING);
+            emailWidth = std::max(emailWidth, contact.getEmail().length() + MIN_PADDING);
+            addressWidth = std::max(addressWidth, contact.getAddress().length() + MIN_PADDING);
+            birthdateWidth = std::max(birthdateWidth, contact.getBirthdate().length() + MIN_PADDING);
+        }
+        
+        size_t getTotalWidth() const {
+            // Add 3 for each " | " separator and 2 for the outer borders
+            return nameWidth + phoneWidth + emailWidth + addressWidth + birthdateWidth + (4 * 3) + 2;
+        }
+    };
+
+    /*
+     * Reads every record from contacts.txt into loaded. The file is streamed
+     * in blocks, with the next LOAD_READ_AHEAD blocks already being read
+     * while one is parsed; complete records of each block are parsed in
+     * parallel, with every chunk feeding its own sketches that are merged
+     * into sketches. In a checksummed file (see ChecksumLines) only whole
+     * checksum blocks are taken from a read block, and their checksums are
+     * verified in parallel. A sealed file (see SealedBlocks) is opened a
+     * whole sealed block at a time, in parallel, before its text is parsed.
+     * Returns false (and leaves the book untouched) if the file cannot be
+     * read or opened, fails its checksums or the load was cancelled with
+     * Ctrl-C.
+     */
+    bool readContactsFile(std::vector<Contact>& loaded, ImportSketches& sketches, StartupProfile& profile) const {
+        FileDescriptor file;
+        size_t fileSize = 0;
+        {
+            auto phase = profile.measure("open");
+            file = FileDescriptor(::open("contacts.txt", O_RDONLY | O_CLOEXEC));
+            struct stat status;
+            if (file && fstat(file.get(), &status) == 0) fileSize = static_cast<size_t>(status.st_size);
+        }
+        if (!file) {
+            std::cerr << "Error: Unable to open file for loading.\n";
+            return false;
+        }
+
+        ProgressReporter progress("Loading", fileSize);
+        InterruptGuard guard(cancellation);
+        std::string pending;                // Unparsed tail carried to the next block
+        uint64_t pendingOffset = 0;         // File offset of pending[0]
+        std::vector<size_t> recordStarts;
+        std::optional<bool> checked;        // Whether the file starts with ChecksumLines::HEADER
+        size_t blockNumber = 0;
+        std::vector<std::string> corruption;
+
+        // Records between two checksum lines
+        struct ChecksumBlock {
+            size_t begin, end;              // Bytes of pending covered by the checksum
+            std::optional<ChecksumLines::Trailer> trailer;
+            size_t firstRecord, records;    // Indexes into recordStarts
+        };
+
+        // Sealed files: raw bytes not yet opened, starting at file offset sealedOffset
+        std::optional<bool> sealed;
+        std::string sealedPending;
+        uint64_t sealedOffset = 0;
+        uint32_t sealedIndex = 0;
+        SealedBlocks::Prefix prefix{};
+
+        // Opens the whole sealed blocks at the front of sealedPending onto pending; false if one fails
+        auto openPending = [&] {
+            auto phase = profile.measure("decrypt");
+            if (sealedOffset == 0) {
+                if (sealedPending.size() < SealedBlocks::HEADER_SIZE) return true;
+                prefix = SealedBlocks::prefixOf(sealedPending);
+                sealedPending.erase(0, SealedBlocks::HEADER_SIZE);
+                sealedOffset = SealedBlocks::HEADER_SIZE;
+            }
+            std::vector<size_t> starts;
+            size_t end = 0;
+            while (end + SealedBlocks::BLOCK_HEADER_SIZE <= sealedPending.size()) {
+                size_t length = SealedBlocks::blockLength(sealedPending.data() + end);
+                if (length > SealedBlocks::MAX_BLOCK_SIZE) {
+                    corruption.push_back("sealed block " + std::to_string(sealedIndex + starts.size()) + " (byte " +
+                                         std::to_string(sealedOffset + end) + ") has an invalid length");
+                    return false;
+                }
+                if (end + length + SealedBlocks::OVERHEAD > sealedPending.size()) break;
+                starts.push_back(end);
+                end += length + SealedBlocks::OVERHEAD;
+            }
+            bool lastInFile = sealedOffset + end == fileSize;
+            std::vector<std::string> opened(starts.size());
+            std::vector<char> intact(starts.size());
+            pool.parallelFor(starts.size(), 1, [&](size_t begin, size_t finish) {
+                for (size_t b = begin; b < finish; ++b) {
+                    intact[b] = SealedBlocks::open(*encryptionKey, prefix, static_cast<uint32_t>(sealedIndex + b),
+                                                   lastInFile && b + 1 == starts.size(), sealedPending.data() + starts[b], opened[b]);
+                }
+            });
+            bool ok = true;
+            for (size_t b = 0; b < starts.size(); ++b) {
+                if (intact[b]) {
+                    pending.append(opened[b]);
+                    continue;
+                }
+                size_t blockEnd = b + 1 < starts.size() ? starts[b + 1] : end;
+                corruption.push_back("sealed block " + std::to_string(sealedIndex + b) + " (bytes " +
+                                     std::to_string(sealedOffset + starts[b]) + "-" +
+                                     std::to_string(sealedOffset + blockEnd) + ") fails authentication" +
+                                     (lastInFile && b + 1 == starts.size() ? "; the file may be truncated" : ""));
+                ok = false;
+            }
+            phase.addBytes(end);
+            sealedIndex += static_cast<uint32_t>(starts.size());
+            sealedPending.erase(0, end);
+            sealedOffset += end;
+            return ok;
+        };
+
+        // Parses the complete records (whole checksum blocks in a checksummed file) at the front of pending
+        auto parsePending = [&] {
+            std::optional<StartupProfile::Scope> parsePhase(std::in_place, profile, "parse", 0);
+            size_t consumed = 0;
+            if (!checked) {
+                size_t newline = pending.find('\n');
+                checked = std::string_view(pending).substr(0, newline) == ChecksumLines::HEADER;
+                if (*checked) consumed = newline + 1;
+            }
+
+            recordStarts.clear();
+            std::vector<ChecksumBlock> blocks;
+            size_t consumedRecords = 0;
+            size_t lineInRecord = 0;
+            size_t recordStart = consumed;
+            size_t blockBegin = consumed;
+            for (size_t lineStart = consumed, newline; (newline = pending.find('\n', lineStart)) != std::string::npos;
+                 lineStart = newline + 1) {
+                if (*checked && lineInRecord == 0 && ChecksumLines::isTrailer(std::string_view(pending).substr(lineStart, 8))) {
+                    auto trailer = ChecksumLines::parseTrailer(std::string_view(pending).substr(lineStart, newline - lineStart));
+                    blocks.push_back({blockBegin, lineStart, trailer, consumedRecords, recordStarts.size() - consumedRecords});
+                    blockBegin = consumed = newline + 1;
+                    consumedRecords = recordStarts.size();
+                    continue;
+                }
+                if (lineInRecord == 0) recordStart = lineStart;
+                if (++lineInRecord == 5) {
+                    lineInRecord = 0;
+                    recordStarts.push_back(recordStart);
+                    if (!*checked) {
+                        consumed = newline + 1;
+                        consumedRecords = recordStarts.size();
+                    }
+                }
+            }
+            recordStarts.resize(consumedRecords);
+            size_t recordCount = recordStarts.size();
+            size_t chunkCount = (recordCount + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+            std::vector<std::vector<Contact>> chunkContacts(chunkCount);
+            std::vector<ImportSketches> chunkSketches(chunkCount);
+
+            pool.parallelFor(recordCount, PARALLEL_CHUNK_SIZE,
+                [&pending, &recordStarts, &chunkContacts, &chunkSketches](size_t begin, size_t end) {
+                    auto& parsed = chunkContacts[begin / PARALLEL_CHUNK_SIZE];
+                    auto& chunkSketch = chunkSketches[begin / PARALLEL_CHUNK_SIZE];
+                    parsed.reserve(end - begin);
+                    for (size_t record = begin; record < end; ++record) {
+                        std::string fields[5];
+                        size_t pos = recordStarts[record];
+                        for (auto& field : fields) {
+                            size_t newline = pending.find('\n', pos);
+                            field.assign(pending, pos, newline - pos);
+                            pos = newline + 1;
+                        }
+                        parsed.emplace_back(fields[0], fields[1], fields[2], fields[3], fields[4]);
+                        chunkSketch.add(parsed.back());
+                    }
+                });
+            parsePhase->addBytes(consumed);
+            parsePhase.reset();
+
+            if (!blocks.empty()) {
+                auto verifyPhase = profile.measure("verify", consumed);
+                std::vector<char> intact(blocks.size());
+                pool.parallelFor(blocks.size(), 1, [&pending, &blocks, &intact](size_t begin, size_t end) {
+                    for (size_t b = begin; b < end; ++b) {
+                        const ChecksumBlock& block = blocks[b];
+                        intact[b] = block.trailer && block.trailer->records == block.records &&
+                                    Crc32c::compute(pending.data() + block.begin, block.end - block.begin) == block.trailer->crc;
+                    }
+                });
+                for (size_t b = 0; b < blocks.size(); ++b) {
+                    ++blockNumber;
+                    if (intact[b]) continue;
+                    size_t first = loaded.size() + blocks[b].firstRecord + 1;
+                    corruption.push_back("block " + std::to_string(blockNumber) + ": records " + std::to_string(first) +
+                                         "-" + std::to_string(first + blocks[b].records - 1) + " (bytes " +
+                                         std::to_string(pendingOffset + blocks[b].begin) + "-" +
+                                         std::to_string(pendingOffset + blocks[b].end) + ") fail their checksum");
+                }
+            }
+
+            auto allocatePhase = profile.measure("allocate", recordCount * sizeof(Contact));
+            for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+                std::move(chunkContacts[chunk].begin(), chunkContacts[chunk].end(), std::back_inserter(loaded));
+                sketches.merge(chunkSketches[chunk]);
+            }
+            progress.advance(recordCount, consumed);
+            pending.erase(0, consumed);
+            pendingOffset += consumed;
+        };
+
+        std::vector<std::vector<char>> buffers(LOAD_READ_AHEAD, std::vector<char>(LOAD_BLOCK_SIZE));
+        AsyncIo io(pool);       // Destroyed first, so reads in flight finish before the buffers go
+        std::vector<AsyncIo::Ticket> tickets(LOAD_READ_AHEAD);
+        size_t blockCount = (fileSize + LOAD_BLOCK_SIZE - 1) / LOAD_BLOCK_SIZE;
+        auto startRead = [&](size_t block) {
+            tickets[block % LOAD_READ_AHEAD] = io.read(file.get(), buffers[block % LOAD_READ_AHEAD].data(),
+                                                       LOAD_BLOCK_SIZE, uint64_t(block) * LOAD_BLOCK_SIZE);
+        };
+        for (size_t block = 0; block < std::min(blockCount, LOAD_READ_AHEAD); ++block) startRead(block);
+
+        for (size_t block = 0; block < blockCount && !cancellation.isCancelled(); ++block) {
+            {
+                auto phase = profile.measure("read");
+                int64_t got = io.wait(tickets[block % LOAD_READ_AHEAD]);
+                if (got < 0) {
+                    std::cerr << "Error: Unable to read 'contacts.txt': " << std::strerror(static_cast<int>(-got)) << "\n";
+                    return false;
+                }
+                std::string_view data(buffers[block % LOAD_READ_AHEAD].data(), static_cast<size_t>(got));
+                if (!sealed) sealed = SealedBlocks::isSealed(data);
+                (*sealed ? sealedPending : pending).append(data);
+                phase.addBytes(data.size());
+            }
+            if (block + LOAD_READ_AHEAD < blockCount) startRead(block + LOAD_READ_AHEAD);
+            if (*sealed && !encryptionKey) {
+                std::cerr << "Error: 'contacts.txt' is encrypted; set " << SealedBlocks::KEY_VARIABLE
+                          << " to the key it was saved with.\n";
+                return false;
+            }
+            if (*sealed && !openPending()) break;
+            if (block + 1 == blockCount) {
+                // Like getline, accept a last line without a trailing newline
+                if (!pending.empty() && pending.back() != '\n') pending.push_back('\n');
+            }
+            parsePending();
+        }
+        progress.finish();
+
+        if (cancellation.isCancelled()) {
+            std::cout << "\nLoading cancelled after " << loaded.size()
+                      << " records; the contact book was not changed.\n";
+            return false;
+        }
+        if (sealed.value_or(false) && corruption.empty() && (sealedOffset == 0 || !sealedPending.empty())) {
+            corruption.push_back("bytes " + std::to_string(sealedOffset) + "-" + std::to_string(fileSize) +
+                                 " do not hold a whole sealed block; the file may be truncated");
+        }
+        if (sealed.value_or(false) && sealedIndex > 0 && corruption.size() == sealedIndex) {
+            corruption.assign(1, "no block can be opened; " + std::string(SealedBlocks::KEY_VARIABLE) +
+                                 " is not the key the file was saved with, or the file is damaged");
+        }
+        if (checked.value_or(false) && !pending.empty() && corruption.empty()) {
+            corruption.push_back("bytes " + std::to_string(pendingOffset) + "-" + std::to_string(fileSize) +
+                                 " after record " + std::to_string(loaded.size()) +
+                                 " have no checksum line; the file may be truncated");
+        }
+        if (!corruption.empty()) {
+            std::cerr << "Error: 'contacts.txt' failed its integrity check; the contact book was not changed.\n";
+            for (size_t i = 0; i < std::min(corruption.size(), MAX_REPORTED_CORRUPTIONS); ++i) {
+                std::cerr << "  " << corruption[i] << "\n";
+            }
+            if (corruption.size() > MAX_REPORTED_CORRUPTIONS) {
+                std::cerr << "  ... and " << corruption.size() - MAX_REPORTED_CORRUPTIONS << " more\n";
+            }
+            return false;
+        }
+        reportInvalidRecords(loaded, "contacts.txt", profile);
+        return true;
+    }
+
+    // A city= or province= term that every match must satisfy, if any
+    static const TextPredicate* localityTerm(const QueryNode& query) {
+        auto usable = [](const QueryNode& node) -> const TextPredicate* {
+            if (node.kind() != QueryNode::Kind::Text) return nullptr;
+            const auto& text = static_cast<const TextPredicate&>(node);
+            bool locality = text.field == TextField::City || text.field == TextField::Province;
+            return locality && text.op == TextOp::Equals ? &text : nullptr;
+        };
+        if (query.kind() != QueryNode::Kind::And) return usable(query);
+        for (const auto& child : static_cast<const AndNode&>(query).children) {
+            if (const TextPredicate* term = usable(*child)) return term;
+        }
+        return nullptr;
+    }
+
+    // Evaluates a query over all contacts in column blocks; keeps list order
+    std::vector<Contact> runFilter(const QueryNode& query) const {
+        // Locality terms narrow the candidates through the index instead of a scan
+        if (const TextPredicate* term = localityTerm(query)) {
+            const LocalityIndex::IdSet* ids = term->field == TextField::City
+                ? localities.findCity(term->value) : localities.findProvince(term->value);
+            std::vector<size_t> positions;
+            if (ids) {
+                positions.reserve(ids->size());
+                for (uint64_t id : *ids) positions.push_back(positionById.at(id));
+            }
+            std::sort(positions.begin(), positions.end());
+
+            CompiledQuery compiled(query);
+            std::vector<Contact> results;
+            Contact scratch;
+            for (size_t position : positions) {
+                const Contact& contact = bodyAt(position, scratch);
+                if (compiled.matches(contact)) results.push_back(contact);
+            }
+            return results;
+        }
+
+        if (columns.isStale()) columns.rebuild(contacts);
+
+        size_t chunkCount = (contacts.size() + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+        std::vector<FilterEngine::Bitmap> selections(chunkCount);
+        pool.parallelFor(contacts.size(), PARALLEL_CHUNK_SIZE,
+            [this, &query, &selections](size_t begin, size_t end) {
+                auto& selection = selections[begin / PARALLEL_CHUNK_SIZE];
+                if (evictedContacts == 0) {
+                    selection = FilterEngine::evaluate(query, columns, contacts, begin, end);
+                } else {
+                    selection = FilterEngine::evaluate(query, columns, ChunkRows(*this, begin, end), begin, end);
+                }
+            });
+
+        std::vector<Contact> results;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+            const auto& bitmap = selections[chunk];
+            for (size_t w = 0; w < bitmap.size(); ++w) {
+                for (uint64_t bits = bitmap[w]; bits; bits &= bits - 1) {
+                    size_t row = chunk * PARALLEL_CHUNK_SIZE + w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
+                    results.push_back(bodyCopy(row));
+                }
+            }
+        }
+        return results;
+    }
+
+    // Loads contacts.txt on the pool and replaces the book on success
+    Task<bool> loadContactsFile() {
+        OperationTrace trace("load", "file=contacts.txt");
+        std::vector<Contact> loaded;
+        ImportSketches sketches;
+        StartupProfile profile;
+        bool ok = co_await loop.runInBackground(pool, [this, &loaded, &sketches, &profile] {
+            return readContactsFile(loaded, sketches, profile);
+        }, TaskPriority::Background);
+        trace.phase("read_parse");
+        if (ok) {
+            replaceAllContacts(std::move(loaded), profile);
+            lastImport = std::make_unique<ImportSketches>(std::move(sketches));
+            trace.phase("index");
+            std::cout << "\nContacts loaded successfully from 'contacts.txt'.\n";
+        }
+        finishOperation(trace);
+        co_return ok;
+    }
+
+    // Records a finished operation in the slow log and the metrics
+    void finishOperation(const OperationTrace& trace) const {
+        bool slow = slowOperations.submit(trace, contacts.size());
+        metrics.observe(trace, slow);
+    }
+
+    /*
+     * Writes the current metrics to metricsPath. Samples are gathered on
+     * the loop thread; the file is written by a background pool task, and a
+     * tick is skipped while the previous write is still pending.
+     */
+    void exportMetrics() const {
+        if (metricsWrite.valid() && metricsWrite.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        metricsWrite = pool.submit([path = metricsPath, text = metrics.render(metricSamples())] {
+            if (!MetricsExporter::writeFile(path, text)) {
+                std::cerr << "Error: Unable to write metrics to '" << path << "'.\n";
+            }
+        }, TaskPriority::Background);
+    }
+
+    // Final metrics on exit, written once any background write has finished
+    void exportMetricsNow() const {
+        if (metricsWrite.valid()) metricsWrite.wait();
+        if (!metrics.write(metricsPath, metricSamples())) {
+            std::cerr << "Error: Unable to write metrics to '" << metricsPath << "'.\n";
+        }
     }
 
-    struct ColumnWidths {
-        size_t nameWidth = 4;      // "NAME"
-        size_t phoneWidth = 5;     // "PHONE"
-        size_t emailWidth = 5;     // "EMAIL"
-        size_t addressWidth = 7;   // "ADDRESS"
-        size_t birthdateWidth = 9; // "BIRTHDATE"
-        
-        // Add minimum padding to each column
-        static constexpr size_t MIN_PADDING = 4; // 2 spaces on each side
-        
-        void updateWidths(const Contact& contact) {
-            nameWidth = std::max(nameWidth, contact.getName().length() + MIN_PADDING);
-            // Phone number will always be in format "+63 (XXX) XXX XXXX"
-            phoneWidth = std::max(phoneWidth, size_t(20) + MIN_PADDING);
-            emailWidth = std::max(emailWidth, contact.getEmail().length() + MIN_PADDING);
-            addressWidth = std::max(addressWidth, contact.getAddress().length() + MIN_PADDING);
-            birthdateWidth = std::max(birthdateWidth, contact.getBirthdate().length() + MIN_PADDING);
+    std::vector<MetricsExporter::Sample> metricSamples() const {
+        using Sample = MetricsExporter::Sample;
+        ThreadPool::Metrics poolMetrics = pool.metrics();
+        size_t contactBytes = contacts.capacity() * sizeof(Contact) + residentBodyBytes + fieldBytes;
+        auto positionBytes = hashMapBytes(positionById, [](size_t) { return size_t(0); });
+
+        const char* memoryHelp = "Approximate heap bytes per data structure.";
+        const char* indexHelp = "Distinct keys per index.";
+        std::vector<Sample> samples = {
+            {"contactbook_contacts", "gauge", "Contacts in the book.", "", double(contacts.size())},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"contacts\"", double(contactBytes)},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"name_phone_index\"", double(index.memoryBytes())},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"id_positions\"", double(positionBytes)},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"locality_index\"", double(localities.memoryBytes())},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"filter_columns\"", double(columns.memoryBytes())},
+            {"contactbook_memory_bytes", "gauge", memoryHelp, "structure=\"saved_searches\"", double(savedSearches.memoryBytes())},
+            {"contactbook_index_keys", "gauge", indexHelp, "index=\"name\"", double(index.distinctNames())},
+            {"contactbook_index_keys", "gauge", indexHelp, "index=\"phone\"", double(index.distinctPhones())},
+            {"contactbook_index_keys", "gauge", indexHelp, "index=\"city\"", double(localities.cityCount())},
+            {"contactbook_index_keys", "gauge", indexHelp, "index=\"province\"", double(localities.provinceCount())},
+            {"contactbook_saved_searches", "gauge", "Saved searches.", "", double(savedSearches.all().size())},
+            {"contactbook_pool_workers", "gauge", "Thread pool workers.", "", double(poolMetrics.workerCount)},
+            {"contactbook_pool_queued_tasks", "gauge", "Tasks waiting in the thread pool.", "priority=\"interactive\"",
+             double(poolMetrics.queuedInteractive)},
+            {"contactbook_pool_queued_tasks", "gauge", "Tasks waiting in the thread pool.", "priority=\"background\"",
+             double(poolMetrics.queuedBackground)},
+            {"contactbook_pool_tasks_executed_total", "counter", "Tasks run by the thread pool since start.", "",
+             double(poolMetrics.executed)},
+            {"contactbook_pool_steals_total", "counter", "Tasks stolen between workers since start.", "", double(poolMetrics.steals)},
+            {"contactbook_memory_limit_bytes", "gauge", "Budget for resident contact bodies, 0 if unlimited.", "",
+             double(memoryLimit)},
+            {"contactbook_resident_body_bytes", "gauge", "Heap bytes of contact bodies in memory.", "",
+             double(residentBodyBytes)},
+            {"contactbook_evicted_contacts", "gauge", "Contacts whose body is only in the spill file.", "",
+             double(evictedContacts)},
+            {"contactbook_spill_file_bytes", "gauge", "Size of the spill file.", "", double(spill.bytes())},
+            {"contactbook_evictions_total", "counter", "Contact bodies evicted to the spill file.", "",
+             double(evictionStats.evictions)},
+            {"contactbook_eviction_reloads_total", "counter", "Evicted bodies made resident again on access.", "",
+             double(evictionStats.reloads)},
+            {"contactbook_spill_reads_total", "counter", "Evicted bodies read by scans.", "",
+             double(evictionStats.spillReads.load())},
+        };
+        return samples;
+    }
+
+    // Saves contacts.txt on the pool
+    Task<bool> saveContactsFile() const {
+        OperationTrace trace("save", "file=contacts.txt");
+        bool ok = co_await loop.runInBackground(pool, [this, &trace] { return writeContactsFile(trace); },
+                                                TaskPriority::Background);
+        if (ok) std::cout << "\nContacts saved successfully to 'contacts.txt'.\n";
+        finishOperation(trace);
+        co_return ok;
+    }
+
+    /*
+     * Writes all contacts to contacts.txt through a temporary file so that a
+     * cancelled or failed save never leaves a truncated contact file behind.
+     * Each batch of contacts is formatted in parallel, one reusable buffer
+     * per chunk, and its buffers are written asynchronously while the next
+     * batch is formatted into the other half of the buffers. Each chunk
+     * ends with its checksum line and, with an encryption key, is sealed
+     * as one block (see SealedBlocks) by the task that formatted it.
+     */
+    bool writeContactsFile(OperationTrace& trace) const {
+        const std::string path = "contacts.txt";
+        const std::string tempPath = path + ".tmp";
+        FileDescriptor file(::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (!file) {
+            std::cerr << "Error: Unable to open file for saving.\n";
+            return false;
         }
-        
-        size_t getTotalWidth() const {
-            // Add 3 for each " | " separator and 2 for the outer borders
-            return nameWidth + phoneWidth + emailWidth + addressWidth + birthdateWidth + (4 * 3) + 2;
+
+        ProgressReporter progress("Saving", contacts.size());
+        InterruptGuard guard(cancellation);
+        std::vector<std::string> buffers(2 * SAVE_BATCH_CHUNKS);
+        std::vector<std::optional<AsyncIo::Ticket>> writes(buffers.size());
+        AsyncIo io(pool);       // Destroyed first, so writes in flight finish before the buffers go
+        std::string header = std::string(ChecksumLines::HEADER) + "\n";
+
+        // Sealed, the header line is block 0 and chunk i is block i + 1
+        SealedBlocks::Prefix prefix{};
+        const size_t room = encryptionKey ? SealedBlocks::BLOCK_HEADER_SIZE : 0;
+        if (encryptionKey) {
+            prefix = SealedBlocks::randomPrefix();
+            header.insert(0, room, '\0');
+            SealedBlocks::seal(*encryptionKey, prefix, 0, contacts.empty(), header);
+            header.insert(0, SealedBlocks::header(prefix));
         }
-    };
+        bool ok = io.wait(io.write(file.get(), header.data(), header.size(), 0)) == static_cast<int64_t>(header.size());
+        auto finishWrite = [&](size_t buffer) {
+            if (!writes[buffer]) return;
+            ok = io.wait(*writes[buffer]) == static_cast<int64_t>(buffers[buffer].size()) && ok;
+            writes[buffer].reset();
+        };
+
+        uint64_t offset = header.size();
+        const size_t batchSize = SAVE_BATCH_CHUNKS * PARALLEL_CHUNK_SIZE;
+        for (size_t batch = 0; ok && batch < contacts.size() && !cancellation.isCancelled(); batch += batchSize) {
+            size_t batchEnd = std::min(contacts.size(), batch + batchSize);
+            size_t first = (batch / batchSize % 2) * SAVE_BATCH_CHUNKS;    // This batch's half of the buffers
+            for (size_t buffer = first; buffer < first + SAVE_BATCH_CHUNKS; ++buffer) finishWrite(buffer);
+
+            pool.parallelFor(batchEnd - batch, PARALLEL_CHUNK_SIZE,
+                             [this, batch, first, room, &prefix, &buffers](size_t begin, size_t end) {
+                std::string& buffer = buffers[first + begin / PARALLEL_CHUNK_SIZE];
+                buffer.assign(room, '\0');     // Keeps the capacity from earlier batches
+                std::vector<Contact> restored;
+                for (const Contact* contact : bodiesInRange(batch + begin, batch + end, restored)) {
+                    for (const std::string* field : {&contact->getName(), &contact->getPhoneNumber(), &contact->getEmail(),
+                                                     &contact->getAddress(), &contact->getBirthdate()}) {
+                        buffer.append(*field);
+                        buffer.push_back('\n');
+                    }
+                }
+                // Every chunk is one checksum block, and one sealed block
+                buffer.append(ChecksumLines::trailer(end - begin, Crc32c::compute(std::string_view(buffer).substr(room))));
+                buffer.push_back('\n');
+                if (encryptionKey) {
+                    SealedBlocks::seal(*encryptionKey, prefix, static_cast<uint32_t>(1 + (batch + begin) / PARALLEL_CHUNK_SIZE),
+                                       batch + end == contacts.size(), buffer);
+                }
+            });
+
+            for (size_t chunk = 0; chunk * PARALLEL_CHUNK_SIZE < batchEnd - batch; ++chunk) {
+                const std::string& buffer = buffers[first + chunk];
+                writes[first + chunk] = io.write(file.get(), buffer.data(), buffer.size(), offset);
+                offset += buffer.size();
+            }
+            progress.advance(batchEnd - batch);
+        }
+        for (size_t buffer = 0; buffer < buffers.size(); ++buffer) finishWrite(buffer);
+        ok = file.close() && ok;
+        progress.finish();
+        trace.phase("write");
+
+        if (cancellation.isCancelled() || !ok) {
+            std::remove(tempPath.c_str());
+            if (cancellation.isCancelled()) {
+                std::cout << "\nSaving cancelled; 'contacts.txt' was not changed.\n";
+            } else {
+                std::cerr << "Error: Unable to write contacts to file.\n";
+            }
+            return false;
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Error: Unable to replace 'contacts.txt'.\n";
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        trace.phase("rename");
+        return true;
+    }
 
-    // Displays contacts in a formatted table
-    void displayContactTable(const std::vector<Contact>& contacts) const {
+    // Displays contacts in a formatted table; Rows is indexable like a vector
+    template<typename Rows>
+    void displayContactTable(const Rows& contacts) const {
         // Calculate required column widths
         ColumnWidths widths;
-        for (const auto& contact : contacts) {
-            widths.updateWidths(contact);
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            widths.updateWidths(contacts[i]);
         }
         
         // Create the separator line
@@ -249,7 +5941,8 @@ private:
         std::cout << separator << '\n';
 
         // Display contacts
-        for (const auto& contact : contacts) {
+        for (size_t i = 0; i < contacts.size(); ++i) {
+            const Contact& contact = contacts[i];
             std::cout << "| " << std::left
                       << std::setw(widths.nameWidth) << contact.getName() << " | "
                       << std::setw(widths.phoneWidth) << InputValidator::formatPhoneNumber(contact.getPhoneNumber()) << " | "
@@ -261,215 +5954,341 @@ private:
     }
 
 public:
+    ContactBook() {
+        observers.push_back(&birthdays);
+        observers.push_back(&statistics);
+        observers.push_back(&columns);
+        observers.push_back(&savedSearches);
+        observers.push_back(&localities);
+        savedSearches.loadDefinitions(contacts);
+        birthdays.setCallback([](const std::string& message) {
+            std::cout << "\n[Reminder] " << message << "\n" << std::flush;
+        });
+        loop.every(std::chrono::minutes(1), [this] { birthdays.poll(); });
+    }
+
+    ContactBook(const ContactBook&) = delete;
+    ContactBook& operator=(const ContactBook&) = delete;
+
     // Add new contact
-    void addContact() {
+    Task<void> addContact() {
         displayHeader("ADD NEW CONTACT");
         
-        std::string name = InputValidator::getValidInput(
-            "Enter name: ",
-            InputValidator::isValidName,
-            ErrorMessages::nameLength(InputValidator::MAX_TEXT_LENGTH) + "\n" + 
-            ErrorMessages::nameFormat()
-        );
-
-        std::string phone = InputValidator::getValidInput(
-            "Enter phone number (11 digits starting with '09'): ",
-            InputValidator::isValidPhoneNumber,
-            ErrorMessages::phoneFormat()
-        );
-
-        std::string email = InputValidator::getValidInput(
-            "Enter email: ",
-            InputValidator::isValidEmail,
-            ErrorMessages::emailFormat()
-        );
-
-        std::string address = InputValidator::getValidInput(
-            "Enter address: ",
-            InputValidator::isValidAddress,
-            ErrorMessages::addressLength(InputValidator::MAX_TEXT_LENGTH)
-        );
-
-        std::string birthdate = InputValidator::getValidInput(
-            "Enter birthdate (DD/MM/YYYY): ",
-            InputValidator::isValidBirthdate,
-            ErrorMessages::birthdateFormat()
-        );
-
-        Contact contact(name, phone, email, address, birthdate);
-        contacts.push_back(contact);
+        std::string name = co_await InputValidator::getValidInput(loop, "Enter name: ", InputValidator::checkName);
+
+        std::string phone = co_await InputValidator::getValidInput(
+            loop, "Enter phone number (11 digits starting with '09'): ", InputValidator::checkPhoneNumber);
+
+        std::string email = co_await InputValidator::getValidInput(loop, "Enter email: ", InputValidator::checkEmail);
+
+        std::string address = co_await InputValidator::getValidInput(loop, "Enter address: ", InputValidator::checkAddress);
+
+        std::string birthdate = co_await InputValidator::getValidInput(
+            loop, "Enter birthdate (DD/MM/YYYY): ", InputValidator::checkBirthdate);
+
+        OperationTrace trace("add");
+        insertContact(Contact(name, phone, email, address, birthdate));
+        finishOperation(trace);
         
         std::cout << "\nContact added successfully!\n";
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+        co_await pressEnterToContinue();
     }
 
     // Search for contacts (recursive matching)
-    void searchContact() const {
+    Task<void> searchContact() const {
         displayHeader("SEARCH CONTACT");
         
-        std::string searchTerm = toUpper(getInput("Enter search term: "));
+        std::string searchTerm = toUpper(co_await getInput("Enter search term: "));
         if (searchTerm.empty()) {
             std::cout << "\nSearch term cannot be empty!\n";
-            std::cout << "\nPress Enter to continue...";
-            std::cin.get();
-            return;
+            co_await pressEnterToContinue();
+            co_return;
         }
 
+        OperationTrace trace("search", "term=" + OperationTrace::redact(searchTerm));
+
+        // Each chunk collects its own matches so results keep list order
+        size_t chunkCount = (contacts.size() + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+        std::vector<std::vector<Contact>> chunkResults(chunkCount);
+        ProgressReporter progress("Searching", contacts.size());
+        co_await loop.runInBackground(pool, [this, &searchTerm, &chunkResults, &progress] {
+            InterruptGuard guard(cancellation);
+            pool.parallelFor(contacts.size(), PARALLEL_CHUNK_SIZE,
+                [this, &searchTerm, &chunkResults, &progress](size_t begin, size_t end) {
+                    if (cancellation.isCancelled()) return;
+                    auto& matches = chunkResults[begin / PARALLEL_CHUNK_SIZE];
+                    Contact scratch;
+                    for (size_t i = begin; i < end; ++i) {
+                        const Contact& contact = bodyAt(i, scratch);
+                        // Check all fields for partial matches
+                        if (toUpper(contact.getName()).find(searchTerm) != std::string::npos ||
+                            toUpper(contact.getPhoneNumber()).find(searchTerm) != std::string::npos ||
+                            toUpper(contact.getEmail()).find(searchTerm) != std::string::npos ||
+                            toUpper(contact.getAddress()).find(searchTerm) != std::string::npos ||
+                            toUpper(contact.getBirthdate()).find(searchTerm) != std::string::npos) {
+                            matches.push_back(contact);
+                        }
+                    }
+                    progress.advance(end - begin);
+                });
+        });
+        progress.finish();
+        trace.phase("scan");
+
         std::vector<Contact> results;
-        
-        for (const auto& contact : contacts) {
-            // Check all fields for partial matches
-            if (toUpper(contact.getName()).find(searchTerm) != std::string::npos ||
-                toUpper(contact.getPhoneNumber()).find(searchTerm) != std::string::npos ||
-                toUpper(contact.getEmail()).find(searchTerm) != std::string::npos ||
-                toUpper(contact.getAddress()).find(searchTerm) != std::string::npos ||
-                toUpper(contact.getBirthdate()).find(searchTerm) != std::string::npos) {
-                results.push_back(contact);
-            }
+        for (auto& matches : chunkResults) {
+            results.insert(results.end(), matches.begin(), matches.end());
         }
-        
+        trace.phase("merge");
+
+        if (cancellation.isCancelled()) {
+            std::cout << "\nSearch cancelled after " << progress.recordsProcessed()
+                      << " of " << contacts.size() << " contacts (partial results below).\n";
+        }
+
         if (results.empty()) {
             std::cout << "\nNo contacts found matching your search.\n";
         } else {
             std::cout << "\nFound " << results.size() << " matching contact(s):\n\n";
             displayContactTable(results);
         }
+        trace.phase("display");
+        finishOperation(trace);
         
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+        co_await pressEnterToContinue();
+    }
+
+    // Filter contacts with a query over their fields
+    Task<void> filterContacts() const {
+        displayHeader("FILTER CONTACTS");
+        std::cout << "\nExamples:  year=1990..2000 and prefix=0917\n"
+                  << "           month=5 or (domain=gmail.com and not city=\"Cebu City\")\n"
+                  << "Numeric fields: year month day prefix  (= != < <= > >= low..high)\n"
+                  << "Text fields:    name phone email address birthdate domain city province  (= != ~)\n\n";
+
+        std::string queryText = co_await getInput("Enter filter: ");
+        OperationTrace trace("filter", "query=" + OperationTrace::redactQuery(queryText));
+        QueryNodePtr query;
+        try {
+            query = QueryParser::parse(queryText);
+        } catch (const std::invalid_argument& error) {
+            std::cout << "\n" << error.what() << "\n";
+        }
+        if (!query) {
+            co_await pressEnterToContinue();
+            co_return;
+        }
+        trace.phase("parse");
+
+        auto started = std::chrono::steady_clock::now();
+        std::vector<Contact> results = co_await loop.runInBackground(pool, [this, &query] {
+            return runFilter(*query);
+        });
+        double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        trace.phase("evaluate");
+
+        if (results.empty()) {
+            std::cout << "\nNo contacts match this filter.\n";
+        } else {
+            std::cout << "\nFound " << results.size() << " matching contact(s):\n\n";
+            displayContactTable(results);
+        }
+        std::cout << "\nFiltered " << contacts.size() << " contacts in "
+                  << std::fixed << std::setprecision(2) << elapsedMs << " ms.\n";
+        std::cout.unsetf(std::ios::floatfield);
+        trace.phase("display");
+        finishOperation(trace);
+        co_await pressEnterToContinue();
+    }
+
+    // Create, open and delete saved searches
+    Task<void> manageSavedSearches() {
+        while (true) {
+            displayHeader("SAVED SEARCHES");
+            const auto& searches = savedSearches.all();
+            if (searches.empty()) {
+                std::cout << "\nNo saved searches yet.\n";
+            } else {
+                std::cout << '\n';
+                for (size_t i = 0; i < searches.size(); ++i) {
+                    std::cout << (i + 1) << ". " << searches[i].name << "  [" << searches[i].queryText
+                              << "]  (" << searches[i].matchingIds.size() << " contacts)\n";
+                }
+            }
+            std::cout << "\nEnter a number to open a search, 'N' for a new search,"
+                      << "\n'D' followed by a number to delete one (e.g. D2), or 'Q' to go back.\n";
+            std::string choice = toUpper(co_await getInput("\nEnter your choice: "));
+
+            if (choice == "Q") co_return;
+
+            if (choice == "N") {
+                std::string name = co_await getInput("Search name: ");
+                std::string queryText = co_await getInput("Filter (as in Filter Contacts): ");
+                std::string error;
+                OperationTrace trace("saved_search_create", "query=" + OperationTrace::redactQuery(queryText));
+                try {
+                    savedSearches.add(name.empty() ? queryText : name, queryText, BodyView{*this});
+                } catch (const std::invalid_argument& invalid) {
+                    error = invalid.what();
+                }
+                finishOperation(trace);
+                std::cout << '\n' << (error.empty() ? "Search saved." : error) << '\n';
+                co_await pressEnterToContinue();
+                continue;
+            }
+
+            bool deleting = !choice.empty() && choice[0] == 'D';
+            std::string digits = deleting ? choice.substr(1) : choice;
+            size_t number = 0;
+            if (!digits.empty() && std::all_of(digits.begin(), digits.end(), ::isdigit) && digits.size() < 6) {
+                number = static_cast<size_t>(std::stoul(digits));
+            }
+            if (number == 0 || number > searches.size()) {
+                std::cout << "\nInvalid choice!\n";
+                co_await pressEnterToContinue();
+                continue;
+            }
+
+            if (deleting) {
+                savedSearches.remove(number - 1);
+                std::cout << "\nSaved search deleted.\n";
+            } else {
+                const auto& search = searches[number - 1];
+                std::vector<Contact> results;
+                results.reserve(search.matchingIds.size());
+                for (uint64_t id : search.matchingIds) results.push_back(bodyCopy(positionById.at(id)));
+
+                displayHeader(search.name);
+                if (results.empty()) {
+                    std::cout << "\nNo contacts match this search.\n";
+                } else {
+                    std::cout << "\n" << results.size() << " matching contact(s):\n\n";
+                    displayContactTable(results);
+                }
+            }
+            co_await pressEnterToContinue();
+        }
     }
 
     // Delete a contact
-    bool deleteContact() {
+    Task<bool> deleteContact() {
         while (true) {
             displayHeader("DELETE CONTACT");
             
             if (contacts.empty()) {
                 std::cout << "\nNo contacts in address book!\n";
-                std::cout << "\nPress Enter to continue...";
-                std::cin.get();
-                return false;
+                co_await pressEnterToContinue();
+                co_return false;
             }
 
             std::cout << "\nCurrent Contacts:\n\n";
-            displayContactTable(contacts);
+            displayContactTable(BodyView{*this});
             
-            std::string name = getInput("\nEnter contact name to delete (or 'Q' to go back): ");
+            std::string name = co_await getInput("\nEnter contact name to delete (or 'Q' to go back): ");
             
             if (toUpper(name) == "Q") {
-                return false;
+                co_return false;
             }
 
-            auto it = std::find_if(contacts.begin(), contacts.end(),
-                [&name](const Contact& c) { return c.getName() == name; });
+            std::optional<size_t> position = findPositionByName(name);
 
-            if (it != contacts.end()) {
-                contacts.erase(it);
+            if (position) {
+                OperationTrace trace("delete");
+                eraseContactAt(*position);
+                finishOperation(trace);
                 std::cout << "\nContact deleted successfully!\n";
-                std::cout << "\nPress Enter to continue...";
-                std::cin.get();
-                return true;
+                co_await pressEnterToContinue();
+                co_return true;
             }
             
             std::cout << "\nContact not found!\n";
-            std::string retry = toUpper(getInput("Would you like to try again? (Y/N): "));
+            std::string retry = toUpper(co_await getInput("Would you like to try again? (Y/N): "));
             if (retry != "Y") {
-                return false;
+                co_return false;
             }
         }
     }
 
     // Modify existing contact
-    bool modifyContact() {
+    Task<bool> modifyContact() {
         while (true) {
             displayHeader("MODIFY CONTACT");
             
             if (contacts.empty()) {
                 std::cout << "\nNo contacts in address book!\n";
-                std::cout << "\nPress Enter to continue...";
-                std::cin.get();
-                return false;
+                co_await pressEnterToContinue();
+                co_return false;
             }
 
             std::cout << "\nCurrent Contacts:\n\n";
-            displayContactTable(contacts);
+            displayContactTable(BodyView{*this});
             
-            std::string name = getInput("\nEnter contact name to modify (or 'Q' to go back): ");
+            std::string name = co_await getInput("\nEnter contact name to modify (or 'Q' to go back): ");
             
             if (toUpper(name) == "Q") {
-                return false;
+                co_return false;
             }
 
-            auto it = std::find_if(contacts.begin(), contacts.end(),
-                [&name](const Contact& c) { return c.getName() == name; });
+            std::optional<size_t> position = findPositionByName(name);
 
-            if (it != contacts.end()) {
+            if (position) {
+                touch(*position);
+                Contact updated = contacts[*position];
+                const uint64_t id = updated.getId();
+                const uint64_t expectedVersion = updated.getVersion();
                 std::cout << "\nSelected contact details:\n";
-                std::vector<Contact> currentContact = {*it};
+                std::vector<Contact> currentContact = {updated};
                 displayContactTable(currentContact);
                 
                 std::cout << "\nEnter new details (press Enter to keep current value):\n";
                 
                 std::string input;
                 
-                input = InputValidator::getValidInput(
-                    "Name [" + it->getName() + "]: ",
-                    InputValidator::isValidName,
-                    ErrorMessages::nameLength(InputValidator::MAX_TEXT_LENGTH) + "\n" + 
-                    ErrorMessages::nameFormat(),
-                    true
-                );
-                if (!input.empty()) it->setName(input);
+                input = co_await InputValidator::getValidInput(loop, "Name", InputValidator::checkName, &updated.getName());
+                if (!input.empty()) updated.setName(input);
                 
-                input = InputValidator::getValidInput(
-                    "Phone [" + it->getPhoneNumber() + "]: ",
-                    InputValidator::isValidPhoneNumber,
-                    ErrorMessages::phoneFormat(),
-                    true
-                );
-                if (!input.empty()) it->setPhoneNumber(input);
+                input = co_await InputValidator::getValidInput(loop, "Phone", InputValidator::checkPhoneNumber, &updated.getPhoneNumber());
+                if (!input.empty()) updated.setPhoneNumber(input);
                 
-                input = InputValidator::getValidInput(
-                    "Email [" + it->getEmail() + "]: ",
-                    InputValidator::isValidEmail,
-                    ErrorMessages::emailFormat(),
-                    true
-                );
-                if (!input.empty()) it->setEmail(input);
+                input = co_await InputValidator::getValidInput(loop, "Email", InputValidator::checkEmail, &updated.getEmail());
+                if (!input.empty()) updated.setEmail(input);
                 
-                input = InputValidator::getValidInput(
-                    "Address [" + it->getAddress() + "]: ",
-                    InputValidator::isValidAddress,
-                    ErrorMessages::addressLength(InputValidator::MAX_TEXT_LENGTH),
-                    true
-                );
-                if (!input.empty()) it->setAddress(input);
+                input = co_await InputValidator::getValidInput(loop, "Address", InputValidator::checkAddress, &updated.getAddress());
+                if (!input.empty()) updated.setAddress(input);
                 
-                input = InputValidator::getValidInput(
-                    "Birthdate [" + it->getBirthdate() + "]: ",
-                    InputValidator::isValidBirthdate,
-                    ErrorMessages::birthdateFormat(),
-                    true
-                );
-                if (!input.empty()) it->setBirthdate(input);
+                input = co_await InputValidator::getValidInput(loop, "Birthdate", InputValidator::checkBirthdate, &updated.getBirthdate());
+                if (!input.empty()) updated.setBirthdate(input);
                 
-                std::cout << "\nContact modified successfully!\n";
-                std::cout << "\nPress Enter to continue...";
-                std::cin.get();
-                return true;
+                OperationTrace trace("modify");
+                UpdateResult result = updateContactIf(id, expectedVersion, std::move(updated));
+                finishOperation(trace);
+                switch (result) {
+                    case UpdateResult::Applied:
+                        std::cout << "\nContact modified successfully!\n";
+                        co_await pressEnterToContinue();
+                        co_return true;
+                    case UpdateResult::Conflict:
+                        std::cout << "\nThis contact was changed by someone else while you were editing.\n"
+                                  << "Your changes were not saved; please review the contact and try again.\n";
+                        break;
+                    case UpdateResult::NotFound:
+                        std::cout << "\nThis contact was deleted while you were editing.\n";
+                        break;
+                }
+                co_await pressEnterToContinue();
+                co_return false;
             }
             
             std::cout << "\nContact not found!\n";
-            std::string retry = toUpper(getInput("Would you like to try again? (Y/N): "));
+            std::string retry = toUpper(co_await getInput("Would you like to try again? (Y/N): "));
             if (retry != "Y") {
-                return false;
+                co_return false;
             }
         }
     }
 
     // Display all contacts
-    void listContacts() {
+    Task<void> listContacts() {
         displayHeader("LIST ALL CONTACTS");
 
         if (contacts.empty()) {
@@ -479,21 +6298,11 @@ public:
                 std::cout << "\n1. Load Contacts from File";
                 std::cout << "\n2. Go Back to Main Menu";
                 std::cout << "\n\nEnter your choice (1-2): ";
-                std::string choice;
-                std::getline(std::cin, choice);
+                std::string choice = co_await loop.readLine();
 
                 if (choice == "1") {
-                    contacts.clear();
-                    std::string name, phone, email, address, birthdate;
-                    while (std::getline(inFile, name) &&
-                           std::getline(inFile, phone) &&
-                           std::getline(inFile, email) &&
-                           std::getline(inFile, address) &&
-                           std::getline(inFile, birthdate)) {
-                        contacts.emplace_back(name, phone, email, address, birthdate);
-                    }
                     inFile.close();
-                    std::cout << "\nContacts loaded successfully from 'contacts.txt'.\n";
+                    co_await loadContactsFile();
                 } else {
                     std::cout << "\nReturning to main menu...\n";
                 }
@@ -501,82 +6310,90 @@ public:
                 std::cout << "\nNo contacts in the program and no contacts listed in 'contacts.txt'.\n";
             }
         } else {
-            displayContactTable(contacts);
+            OperationTrace trace("list");
+            displayContactTable(BodyView{*this});
+            finishOperation(trace);
             std::cout << "\n1. Save Contacts to File";
             std::cout << "\n2. Go Back to Main Menu";
             std::cout << "\n\nEnter your choice (1-2): ";
-            std::string choice;
-            std::getline(std::cin, choice);
+            std::string choice = co_await loop.readLine();
 
             if (choice == "1") {
-                std::ofstream outFile("contacts.txt");
-                if (!outFile) {
-                    std::cerr << "Error: Unable to open file for saving.\n";
-                } else {
-                    for (const auto& contact : contacts) {
-                        outFile << contact.getName() << '\n'
-                                << contact.getPhoneNumber() << '\n'
-                                << contact.getEmail() << '\n'
-                                << contact.getAddress() << '\n'
-                                << contact.getBirthdate() << '\n';
-                    }
-                    outFile.close();
-                    std::cout << "\nContacts saved successfully to 'contacts.txt'.\n";
-                }
+                co_await saveContactsFile();
             } else {
                 std::cout << "\nReturning to main menu...\n";
             }
         }
 
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+        co_await pressEnterToContinue();
     }
 
-    // Save contacts to a file
-    void saveToFile() const {
-        std::ofstream outFile("contacts.txt");
-        if (!outFile) {
-            std::cerr << "Error: Unable to open file for saving.\n";
-            return;
-        }
+    // Display aggregate statistics
+    Task<void> showStatistics() const {
+        displayHeader("CONTACT STATISTICS");
+        OperationTrace trace("statistics");
+        std::cout << "\nTotal contacts: " << statistics.total() << "\n";
 
-        for (const auto& contact : contacts) {
-            outFile << contact.getName() << '\n'
-                    << contact.getPhoneNumber() << '\n'
-                    << contact.getEmail() << '\n'
-                    << contact.getAddress() << '\n'
-                    << contact.getBirthdate() << '\n';
+        static const char* monthNames[12] = {
+            "January", "February", "March", "April", "May", "June",
+            "July", "August", "September", "October", "November", "December"
+        };
+        std::cout << "\nBy birth month:\n";
+        for (size_t month = 0; month < 12; ++month) {
+            std::cout << "  " << std::left << std::setw(12) << monthNames[month]
+                      << std::right << std::setw(8) << statistics.byBirthMonth()[month] << "\n";
         }
 
-        outFile.close();
-        std::cout << "\nContacts saved successfully to 'contacts.txt'.\n";
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
-    }
+        auto printTop = [](const std::string& title, const ContactStatistics::Counts& counts) {
+            std::cout << "\n" << title << " (top " << STATISTICS_TOP_ENTRIES << " of "
+                      << counts.size() << "):\n";
+            for (const auto& [key, count] : ContactStatistics::top(counts, STATISTICS_TOP_ENTRIES)) {
+                std::cout << "  " << std::left << std::setw(30) << (key.empty() ? "(none)" : key)
+                          << std::right << std::setw(8) << count << "\n";
+            }
+        };
+        printTop("By phone prefix", statistics.byPhonePrefix());
+        printTop("By city", statistics.byCity());
+        printTop("By email domain", statistics.byEmailDomain());
 
-    // Load contacts from a file
-    void loadFromFile() {
-        std::ifstream inFile("contacts.txt");
-        if (!inFile) {
-            std::cerr << "Error: Unable to open file for loading.\n";
-            return;
+        if (lastImport) {
+            std::cout << std::fixed << std::setprecision(0)
+                      << "\nLast import (approximate, " << lastImport->recordCount() << " records):\n"
+                      << "  Distinct phone numbers  ~" << lastImport->approximateDistinctPhones() << "\n"
+                      << "  Distinct emails         ~" << lastImport->approximateDistinctEmails() << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout << "  Heaviest email domains:\n";
+            for (const auto& entry : lastImport->topDomains(STATISTICS_TOP_ENTRIES)) {
+                std::cout << "    " << std::left << std::setw(28) << (entry.key.empty() ? "(none)" : entry.key)
+                          << std::right << std::setw(8) << lastImport->approximateDomainCount(entry.key) << "\n";
+            }
         }
+        if (memoryLimit) {
+            std::cout << std::fixed << std::setprecision(1)
+                      << "\nMemory limit:\n"
+                      << "  Contact bodies in memory  " << residentBodyBytes / 1048576.0 << " of "
+                      << memoryLimit / 1048576.0 << " MiB\n"
+                      << "  Evicted contacts          " << evictedContacts << "\n"
+                      << "  Spill file                " << spill.bytes() / 1048576.0 << " MiB\n"
+                      << "  Evictions / reloads       " << evictionStats.evictions << " / " << evictionStats.reloads << "\n"
+                      << "  Bodies read by scans      " << evictionStats.spillReads.load() << "\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+        finishOperation(trace);
 
-        contacts.clear();
-        std::string name, phone, email, address, birthdate;
+        co_await pressEnterToContinue();
+    }
 
-        while (std::getline(inFile, name) &&
-               std::getline(inFile, phone) &&
-               std::getline(inFile, email) &&
-               std::getline(inFile, address) &&
-               std::getline(inFile, birthdate)) {
-            contacts.emplace_back(name, phone, email, address, birthdate);
-        }
+    // Save contacts to a file
+    Task<void> saveToFile() const {
+        co_await saveContactsFile();
+        co_await pressEnterToContinue();
+    }
 
-        inFile.close();
-        std::cout << "\nContacts loaded successfully from 'contacts.txt'.\n";
-        std::cout << "\nPress Enter to continue...";
-        std::cin.get();
+    // Load contacts from a file
+    Task<void> loadFromFile() {
+        co_await loadContactsFile();
+        co_await pressEnterToContinue();
     }
 
     // Display main menu options
@@ -587,46 +6404,610 @@ public:
         std::cout << "\n3. Delete Contact";
         std::cout << "\n4. Modify Contact";
         std::cout << "\n5. List All Contacts";
-        std::cout << "\n6. Exit";
-        std::cout << "\n\nEnter your choice (1-8): ";
+        std::cout << "\n6. Filter Contacts";
+        std::cout << "\n7. Saved Searches";
+        std::cout << "\n8. Statistics";
+        std::cout << "\n9. Exit";
+        std::cout << "\n\nEnter your choice (1-9): ";
+    }
+
+    // Log every input line of this session to path
+    bool recordSession(const std::string& path) {
+        sessionRecording.open(path, std::ios::trunc);
+        if (!sessionRecording) {
+            std::cerr << "Error: Unable to open '" << path << "' for recording.\n";
+            return false;
+        }
+        loop.recordTo(sessionRecording);
+        return true;
+    }
+
+    // Loads contacts.txt on the calling thread, recording each phase
+    bool loadContactsNow(StartupProfile& profile) {
+        std::vector<Contact> loaded;
+        ImportSketches sketches;
+        if (!readContactsFile(loaded, sketches, profile)) return false;
+        replaceAllContacts(std::move(loaded), profile);
+        lastImport = std::make_unique<ImportSketches>(std::move(sketches));
+        return true;
+    }
+
+    // Saves contacts.txt on the calling thread
+    bool saveContactsNow() const {
+        OperationTrace trace("save", "file=contacts.txt");
+        return writeContactsFile(trace);
+    }
+
+    // Export metrics to path every interval, and once more on exit
+    void enableMetrics(const std::string& path, std::chrono::seconds interval) {
+        metricsPath = path;
+        loop.every(interval, [this] { exportMetrics(); });
+    }
+
+    // Caps the memory used by contact bodies; see enforceMemoryLimit()
+    bool setMemoryLimit(size_t bytes) {
+        if (!spill.open()) {
+            std::cerr << "Error: Unable to create a spill file: " << std::strerror(errno) << "\n";
+            return false;
+        }
+        memoryLimit = bytes;
+        residentByAccess.clear();
+        for (const auto& contact : contacts) trackResident(contact);
+        enforceMemoryLimit();
+        return true;
+    }
+
+    // Keeps a fixed-width copy of the book in path. Contacts already in the
+    // file are loaded; an empty or new file is filled from the book.
+    bool setSlotFile(const std::string& path) {
+        auto file = std::make_unique<SlotFile>();
+        if (!file->open(path)) return false;
+        if (file->count() > 0) {
+            std::vector<Contact> loaded;
+            ImportSketches sketches;
+            StartupProfile profile;
+            if (!readSlotFile(*file, loaded, sketches, profile)) return false;
+            replaceAllContacts(std::move(loaded), profile);     // Before attaching, so nothing is rewritten
+            lastImport = std::make_unique<ImportSketches>(std::move(sketches));
+            slots = std::move(file);
+            compactSlotsIfSparse();
+            return slots != nullptr;
+        }
+        slots = std::move(file);
+        writeAllSlots();
+        return slots != nullptr;
+    }
+
+    // Seals contacts.txt on save with a key of 64 hex digits, and opens sealed files on load
+    bool setEncryptionKey(std::string_view hex) {
+        encryptionKey = SealedBlocks::parseKey(hex);
+        if (!encryptionKey) {
+            std::cerr << "Error: " << SealedBlocks::KEY_VARIABLE << " must be 64 hexadecimal digits (a 256-bit key).\n";
+        }
+        return encryptionKey.has_value();
+    }
+
+    // Operations slower than ms are written to slow_operations.log
+    void setSlowOperationThreshold(double ms) { slowOperations.setThresholdMs(ms); }
+
+    // Feed a recorded session back through the menus
+    bool replaySession(const std::string& path) {
+        auto records = SessionRecording::load(path);
+        if (!records) return false;
+        replayedSessionMs = records->empty() ? 0 : records->back().elapsedMs;
+        loop.replayFrom(std::move(*records));
+        return true;
     }
 
     // Main program loop
     void run() {
+        auto started = std::chrono::steady_clock::now();
+        Task<void> session = runSession();
+        try {
+            loop.run(session);
+        } catch (const InputClosedError&) {
+            std::cout << "\n";
+        }
+
+        if (!metricsPath.empty()) exportMetricsNow();
+
+        if (loop.isReplaying()) {
+            double replayedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            std::cerr << "\nReplayed a " << replayedSessionMs << " ms session in "
+                      << std::fixed << std::setprecision(2) << replayedMs << " ms\n\n";
+            std::cerr.unsetf(std::ios::floatfield);
+            operationTimings.print(std::cerr);
+        }
+    }
+
+private:
+    // Interactive session driven by the event loop
+    Task<void> runSession() {
         while (true) {
             displayMenu();
-            std::string choice = getInput("");
+            std::string choice = co_await getInput("");
+            static const char* operationNames[] = {
+                "Add", "Search", "Delete", "Modify", "List", "Filter", "Saved Searches", "Statistics"
+            };
+            auto started = std::chrono::steady_clock::now();
 
             switch (choice[0]) {
                 case '1':
-                    addContact();
+                    co_await addContact();
                     break;
                 case '2':
-                    searchContact();
+                    co_await searchContact();
                     break;
                 case '3':
-                    deleteContact();
+                    co_await deleteContact();
                     break;
                 case '4':
-                    modifyContact();
+                    co_await modifyContact();
                     break;
                 case '5':
-                    listContacts();
+                    co_await listContacts();
                     break;
                 case '6':
+                    co_await filterContacts();
+                    break;
+                case '7':
+                    co_await manageSavedSearches();
+                    break;
+                case '8':
+                    co_await showStatistics();
+                    break;
+                case '9':
                     std::cout << "\nThank you for using Contact Book Management System!\n";
-                    return;
+                    co_return;
                 default:
                     std::cout << "\nInvalid choice! Press Enter to continue...";
-                    std::cin.get();
+                    co_await loop.readLine(InputKind::Pause);
+            }
+            bool known = choice[0] >= '1' && choice[0] <= '8';
+            operationTimings.add(known ? operationNames[choice[0] - '1'] : "Invalid choice",
+                                 std::chrono::steady_clock::now() - started);
+        }
+    }
+};
+
+/*
+ * SyntheticContacts Class: Deterministic generator of valid contacts used
+ * by the benchmarks
+ */
+class SyntheticContacts {
+public:
+    static std::vector<Contact> generate(size_t count, uint64_t seed = 42) {
+        static const char* firstNames[] = {
+            "Juan", "Maria", "Jose", "Ana", "Pedro", "Rosa", "Carlo", "Liza", "Miguel", "Grace"
+        };
+        static const char* lastNames[] = {
+            "Dela Cruz", "Santos", "Reyes", "Garcia", "Mendoza", "Bautista", "Villanueva", "Ramos"
+        };
+        static const char* streets[] = {"Rizal St", "Mabini Ave", "Bonifacio Rd", "Osmena Blvd", "Luna St"};
+        static const char* cities[] = {
+            "Cebu City", "Lapu-Lapu City", "Mandaue City", "Quezon City", "Manila", "Davao City", "Iloilo City"
+        };
+        static const char* domains[] = {"gmail.com", "yahoo.com", "outlook.com", "company.ph", "dlsu.edu.ph"};
+        static const char* prefixes[] = {"0917", "0918", "0919", "0927", "0939", "0945", "0966", "0998"};
+
+        std::vector<Contact> contacts;
+        contacts.reserve(count);
+        uint64_t state = seed;
+        auto next = [&state](uint64_t bound) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            return (state >> 33) % bound;
+        };
+        char buffer[128];
+        for (size_t i = 0; i < count; ++i) {
+            std::string name = std::string(firstNames[next(10)]) + " " + lastNames[next(8)];
+            std::snprintf(buffer, sizeof(buffer), "%s%07u", prefixes[next(8)], static_cast<unsigned>(next(10000000)));
+            std::string phone = buffer;
+            std::snprintf(buffer, sizeof(buffer), "user%zu@%s", i, domains[next(5)]);
+            std::string email = buffer;
+            std::snprintf(buffer, sizeof(buffer), "%u %s, %s", static_cast<unsigned>(1 + next(999)),
+                          streets[next(5)], cities[next(7)]);
+            std::string address = buffer;
+            std::snprintf(buffer, sizeof(buffer), "%02u/%02u/%04u", static_cast<unsigned>(1 + next(28)),
+                          static_cast<unsigned>(1 + next(12)), static_cast<unsigned>(1950 + next(70)));
+            contacts.emplace_back(name, phone, email, address, buffer);
+            Gazetteer::annotate(contacts.back());
+        }
+        return contacts;
+    }
+};
+
+/*
+ * Benchmarks Class: Command-line benchmarks, run as
+ *     contact_book --bench <name> [count]
+ */
+class Benchmarks {
+public:
+    static int run(const std::vector<std::string>& args) {
+        std::string name = args.size() > 1 ? args[1] : "";
+        size_t count = args.size() > 2 ? static_cast<size_t>(std::stoull(args[2])) : 0;
+
+        if (name == "query") {
+            benchQuery(count ? count : 1000000);
+        } else if (name == "startup") {
+            return benchStartup(count ? count : 1000000) ? 0 : 1;
+        } else if (name == "save") {
+            return benchSave(count ? count : 10000000) ? 0 : 1;
+        } else if (name == "encryption") {
+            return benchEncryption(count ? count : 1000000) ? 0 : 1;
+        } else if (name == "validate") {
+            benchValidate(count ? count : 1000000);
+        } else {
+            std::cerr << "Usage: contact_book --bench query|startup|save|encryption|validate [count]\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Constructs a contact book and loads contacts.txt from the current directory
+    static bool startUp(StartupProfile& profile) {
+        std::optional<ContactBook> book;
+        {
+            auto phase = profile.measure("construct");
+            book.emplace();
+        }
+        if (const char* key = std::getenv(SealedBlocks::KEY_VARIABLE); key && !book->setEncryptionKey(key)) return false;
+        return book->loadContactsNow(profile);
+    }
+
+    // --profile-startup: phase breakdown of starting with the current contacts.txt
+    static int profileStartup() {
+        StartupProfile profile;
+        if (!startUp(profile)) return 1;
+        std::cout << "\nStartup profile for 'contacts.txt'\n\n";
+        profile.print(std::cout);
+        std::cout << std::fixed << std::setprecision(2)
+                  << "\nTime to interactive: " << profile.totalWallMs() << " ms\n";
+        return 0;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    template<typename Body>
+    static double nanosecondsPerRow(size_t rows, Body body) {
+        auto started = Clock::now();
+        body();
+        return std::chrono::duration<double, std::nano>(Clock::now() - started).count() / rows;
+    }
+
+    // Makes a fresh temporary directory the current one; returns the previous one
+    static std::optional<std::string> enterTemporaryDirectory() {
+        char directory[] = "/tmp/contact_book_bench_XXXXXX";
+        if (!mkdtemp(directory)) {
+            std::cerr << "Error: Unable to create a temporary directory.\n";
+            return std::nullopt;
+        }
+        std::string previous = std::filesystem::current_path();
+        std::filesystem::current_path(directory);
+        return previous;
+    }
+
+    static void leaveTemporaryDirectory(const std::string& previous) {
+        std::filesystem::remove_all(std::filesystem::current_path());
+        std::filesystem::current_path(previous);
+    }
+
+    /*
+     * Writes count generated contacts to contacts.txt the way saves used to,
+     * with one operator<< per field through a default ofstream. Contacts
+     * are generated in blocks to bound memory; returns the seconds spent
+     * writing.
+     */
+    static double writeSyntheticFile(size_t count) {
+        constexpr size_t BLOCK = 1000000;
+        std::ofstream outFile("contacts.txt", std::ios::trunc);
+        double seconds = 0;
+        for (size_t done = 0; done < count; done += BLOCK) {
+            auto block = SyntheticContacts::generate(std::min(BLOCK, count - done), 42 + done / BLOCK);
+            auto started = Clock::now();
+            for (const auto& contact : block) {
+                outFile << contact.getName() << '\n' << contact.getPhoneNumber() << '\n' << contact.getEmail() << '\n'
+                        << contact.getAddress() << '\n' << contact.getBirthdate() << '\n';
+            }
+            if (done + BLOCK >= count) outFile.close();
+            seconds += std::chrono::duration<double>(Clock::now() - started).count();
+        }
+        return seconds;
+    }
+
+    // Time to interactive for generated contact files of growing size
+    static bool benchStartup(size_t count) {
+        auto previous = enterTemporaryDirectory();
+        if (!previous) return false;
+
+        std::vector<size_t> sizes;
+        for (size_t size : {count / 100, count / 10, count}) {
+            if (size > 0 && (sizes.empty() || size != sizes.back())) sizes.push_back(size);
+        }
+
+        std::cout << "Startup benchmark (wall ms per phase)\n\n";
+        bool ok = true;
+        bool header = false;
+        for (size_t size : sizes) {
+            writeSyntheticFile(size);
+            double fileMb = std::filesystem::file_size("contacts.txt") / 1e6;
+
+            StartupProfile profile;
+            if (!startUp(profile)) {
+                ok = false;
+                break;
+            }
+            if (!header) {
+                std::cout << std::right << std::setw(10) << "CONTACTS" << std::setw(9) << "MB";
+                for (const auto& phase : profile.all()) std::cout << std::setw(11) << phase.name;
+                std::cout << std::setw(11) << "TOTAL" << '\n';
+                header = true;
+            }
+            std::cout << std::fixed << std::setprecision(1) << std::setw(10) << size << std::setw(9) << fileMb;
+            for (const auto& phase : profile.all()) std::cout << std::setw(11) << phase.wallMs;
+            std::cout << std::setw(11) << profile.totalWallMs() << '\n';
+            std::cout.unsetf(std::ios::floatfield);
+        }
+
+        leaveTemporaryDirectory(*previous);
+        return ok;
+    }
+
+    // MB/s of saving count contacts: per-field stream writes vs the save path
+    static bool benchSave(size_t count) {
+        auto previous = enterTemporaryDirectory();
+        if (!previous) return false;
+
+        ThreadPool probePool(1);
+        std::cout << "Save benchmark over " << count << " contacts (I/O backend: "
+                  << AsyncIo(probePool).backend() << ")\n\n";
+        double streamSeconds = writeSyntheticFile(count);
+        double streamMb = std::filesystem::file_size("contacts.txt") / 1e6;
+
+        std::optional<ContactBook> book;
+        book.emplace();
+        StartupProfile profile;
+        bool ok = book->loadContactsNow(profile);
+        auto started = Clock::now();
+        ok = ok && book->saveContactsNow();
+        double saveSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+        double saveMb = ok ? std::filesystem::file_size("contacts.txt") / 1e6 : 0;   // Includes checksum lines
+
+        if (ok) {
+            std::cout << std::left << std::setw(30) << "WRITER" << std::right << std::setw(10) << "MB"
+                      << std::setw(10) << "SECONDS" << std::setw(10) << "MB/S" << '\n';
+            std::cout << std::fixed << std::setprecision(2);
+            for (auto [label, mb, seconds] : {std::tuple{"ofstream, operator<< per field", streamMb, streamSeconds},
+                                              std::tuple{"batched buffers, async writes", saveMb, saveSeconds}}) {
+                std::cout << std::left << std::setw(30) << label << std::right << std::setw(10) << mb
+                          << std::setw(10) << seconds << std::setw(10) << mb / seconds << '\n';
+            }
+            std::cout.unsetf(std::ios::floatfield);
+        } else {
+            std::cerr << "Error: Saving the generated contacts failed.\n";
+        }
+        book.reset();
+        leaveTemporaryDirectory(*previous);
+        return ok;
+    }
+
+    // Cost of sealing contacts.txt: MB/s of saving it, and of reading it up to parsed records, plain and encrypted
+    static bool benchEncryption(size_t count) {
+        auto previous = enterTemporaryDirectory();
+        if (!previous) return false;
+
+        std::cout << "Encryption benchmark over " << count << " contacts (ChaCha20-Poly1305)\n\n";
+        writeSyntheticFile(count);
+        std::optional<ContactBook> book;
+        book.emplace();
+        StartupProfile profile;
+        bool ok = book->loadContactsNow(profile);
+        std::cout << std::left << std::setw(12) << "FILE" << std::right << std::setw(10) << "MB"
+                  << std::setw(12) << "SAVE MB/S" << std::setw(12) << "LOAD MB/S" << '\n';
+        for (bool sealed : {false, true}) {
+            if (sealed) ok = ok && book->setEncryptionKey(std::string(2 * SealedBlocks::Key().size(), '7'));
+            auto started = Clock::now();
+            ok = ok && book->saveContactsNow();
+            double saveSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+            StartupProfile loadProfile;
+            ok = ok && book->loadContactsNow(loadProfile);
+            if (!ok) break;
+            double loadSeconds = 0;
+            for (const char* phase : {"open", "read", "decrypt", "parse", "verify"}) loadSeconds += loadProfile.wallMs(phase) / 1000;
+            double mb = std::filesystem::file_size("contacts.txt") / 1e6;
+            std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(12) << (sealed ? "encrypted" : "plain")
+                      << std::right << std::setw(10) << mb << std::setw(12) << mb / saveSeconds
+                      << std::setw(12) << mb / loadSeconds << '\n';
+            std::cout.unsetf(std::ios::floatfield);
+        }
+        if (!ok) std::cerr << "Error: Saving or loading the generated contacts failed.\n";
+        book.reset();
+        leaveTemporaryDirectory(*previous);
+        return ok;
+    }
+
+    // Validation as the menus used to do it: messages built per call, regular expressions per check
+    static bool legacyValidate(const Contact& contact) {
+        const size_t max = InputValidator::MAX_TEXT_LENGTH;
+        std::string messages[] = {ErrorMessages::nameLength(max) + "\n" + ErrorMessages::nameFormat(), ErrorMessages::phoneFormat(),
+                                  ErrorMessages::emailFormat(max), ErrorMessages::addressLength(max), ErrorMessages::birthdateFormat()};
+        const std::string& name = contact.getName();
+        const std::string& phone = contact.getPhoneNumber();
+        const std::string& email = contact.getEmail();
+        const std::string& date = contact.getBirthdate();
+        if (name.length() < 2 || name.length() > max ||
+            !std::all_of(name.begin(), name.end(), [](char c) { return std::isalpha(c) || std::isspace(c); })) return false;
+        if (phone.length() != 11 || phone.substr(0, 2) != "09" || !std::all_of(phone.begin(), phone.end(), ::isdigit)) return false;
+        if (email.length() > max ||
+            !std::regex_match(email, std::regex(R"([a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,})"))) return false;
+        if (contact.getAddress().length() < 5 || contact.getAddress().length() > max) return false;
+        if (!std::regex_match(date, std::regex(R"((\d{2})/(\d{2})/(\d{4}))"))) return false;
+        int day = std::stoi(date.substr(0, 2)), month = std::stoi(date.substr(3, 2)), year = std::stoi(date.substr(6, 4));
+        return month >= 1 && month <= 12 && day >= 1 && day <= 31 && year >= 1900 && year <= 2025;
+    }
+
+    // Per-record cost of validating contacts, a fifth of them invalid in one field
+    static void benchValidate(size_t count) {
+        constexpr size_t LEGACY_SAMPLE = 10000;      // The regex path takes about a millisecond per record
+        constexpr size_t BATCH = 4096;               // Rows per batch, as in a load chunk
+        std::vector<Contact> contacts = SyntheticContacts::generate(count);
+        for (size_t i = 0; i < contacts.size(); i += 5) {
+            Contact& contact = contacts[i];
+            switch (i / 5 % 5) {
+                case 0: contact.setName("X"); break;
+                case 1: contact.setPhoneNumber("0812345678"); break;
+                case 2: contact.setEmail("user@domain"); break;
+                case 3: contact.setAddress("Cebu"); break;
+                case 4: contact.setBirthdate("31/13/1990"); break;
+            }
+        }
+
+        std::cout << "Validation benchmark over " << count << " contacts\n\n"
+                  << std::left << std::setw(36) << "VALIDATOR" << std::right << std::setw(10) << "RECORDS"
+                  << std::setw(12) << "NS/RECORD" << std::setw(16) << "ALLOCS/RECORD" << std::setw(10) << "INVALID" << '\n';
+        // countInvalid(rows) validates the first rows contacts and returns how many failed
+        auto report = [&](const char* label, size_t rows, auto countInvalid) {
+            size_t invalid = 0;
+            uint64_t allocations = allocationCount.load();
+            double ns = nanosecondsPerRow(rows, [&] { invalid = countInvalid(rows); });
+            double perRecord = double(allocationCount.load() - allocations) / std::max<size_t>(1, rows);
+            std::cout << std::fixed << std::setprecision(1) << std::left << std::setw(36) << label << std::right
+                      << std::setw(10) << rows << std::setw(12) << ns << std::setw(16) << perRecord
+                      << std::setw(10) << invalid << '\n';
+            std::cout.unsetf(std::ios::floatfield);
+        };
+        auto oneByOne = [&](auto valid) {
+            return [&contacts, valid](size_t rows) {
+                size_t invalid = 0;
+                for (size_t i = 0; i < rows; ++i) invalid += !valid(contacts[i]);
+                return invalid;
+            };
+        };
+        auto inBatches = [&](auto valid) {
+            return [&contacts, valid](size_t rows) {
+                size_t invalid = 0;
+                for (size_t begin = 0; begin < rows; begin += BATCH) {
+                    size_t end = std::min(rows, begin + BATCH);
+                    invalid += (end - begin) - FilterEngine::count(valid(contacts, begin, end));
+                }
+                return invalid;
+            };
+        };
+        report("regex, messages built per call", std::min(count, LEGACY_SAMPLE), oneByOne(legacyValidate));
+        report("error codes", count,
+               oneByOne([](const Contact& contact) { return InputValidator::check(contact) == ValidationError::None; }));
+        report("error codes, phone and birthdate", count, oneByOne([](const Contact& contact) {
+            return InputValidator::checkPhoneNumber(contact.getPhoneNumber()) == ValidationError::None &&
+                   InputValidator::checkBirthdate(contact.getBirthdate()) == ValidationError::None;
+        }));
+        report("batch, phone and birthdate", count, inBatches([](const std::vector<Contact>& rows, size_t begin, size_t end) {
+            BatchValidator::Bitmap valid = BatchValidator::validPhones(rows, begin, end);
+            BatchValidator::Bitmap dates = BatchValidator::validBirthdates(rows, begin, end);
+            for (size_t w = 0; w < valid.size(); ++w) valid[w] &= dates[w];
+            return valid;
+        }));
+        report("batch, whole record", count, inBatches([](const std::vector<Contact>& rows, size_t begin, size_t end) {
+            return BatchValidator::validContacts(rows, begin, end);
+        }));
+    }
+
+    // Interpreted tree walk vs compiled branch program vs columnar SIMD filter
+    static void benchQuery(size_t count) {
+        std::vector<Contact> contacts = SyntheticContacts::generate(count);
+        ColumnStore columns;
+        columns.rebuild(contacts);
+
+        const char* queries[] = {
+            "year=1990..2000 and prefix=0917",
+            "month=5 or (domain=gmail.com and not city=\"Cebu City\")",
+            "name~santos and year>=1980",
+            "city=\"Lapu-Lapu City\" and (prefix=0927 or prefix=0939)"
+        };
+
+        std::cout << "Query benchmark over " << count << " contacts (ns per contact)\n\n";
+        std::cout << std::left << std::setw(58) << "QUERY" << std::right
+                  << std::setw(10) << "MATCHES" << std::setw(13) << "INTERPRETED"
+                  << std::setw(10) << "COMPILED" << std::setw(12) << "VECTORIZED" << '\n';
+        for (const char* text : queries) {
+            QueryNodePtr tree = QueryParser::parse(text);
+            CompiledQuery compiled(*tree);
+            size_t interpretedMatches = 0, compiledMatches = 0, vectorizedMatches = 0;
+
+            double interpreted = nanosecondsPerRow(count, [&] {
+                for (const auto& contact : contacts) interpretedMatches += tree->matches(contact);
+            });
+            double compiledTime = nanosecondsPerRow(count, [&] {
+                for (const auto& contact : contacts) compiledMatches += compiled.matches(contact);
+            });
+            double vectorized = nanosecondsPerRow(count, [&] {
+                for (size_t begin = 0; begin < count; begin += 4096) {
+                    auto bitmap = FilterEngine::evaluate(*tree, columns, contacts, begin, std::min(count, begin + 4096));
+                    vectorizedMatches += FilterEngine::count(bitmap);
+                }
+            });
+
+            if (interpretedMatches != compiledMatches || compiledMatches != vectorizedMatches) {
+                std::cout << "Result mismatch for: " << text << '\n';
             }
+            std::cout << std::left << std::setw(58) << text << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << compiledMatches << std::setw(13) << interpreted
+                      << std::setw(10) << compiledTime << std::setw(12) << vectorized << '\n';
+            std::cout.unsetf(std::ios::floatfield);
         }
     }
 };
 
 // Program entry point
-int main() {
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "--bench") {
+        return Benchmarks::run(args);
+    }
+    if (args.size() == 1 && args[0] == "--profile-startup") {
+        return Benchmarks::profileStartup();
+    }
+
     ContactBook contactBook;
+    if (const char* key = std::getenv(SealedBlocks::KEY_VARIABLE); key && !contactBook.setEncryptionKey(key)) return 1;
+    std::string metricsPath;
+    std::chrono::seconds metricsInterval(15);
+    for (size_t i = 0; i < args.size(); i += 2) {
+        bool ok = i + 1 < args.size();
+        if (ok && args[i] == "--record") {
+            ok = contactBook.recordSession(args[i + 1]);
+        } else if (ok && args[i] == "--replay") {
+            ok = contactBook.replaySession(args[i + 1]);
+        } else if (ok && args[i] == "--metrics") {
+            metricsPath = args[i + 1];
+        } else if (ok && args[i] == "--metrics-interval") {
+            char* end = nullptr;
+            long seconds = std::strtol(args[i + 1].c_str(), &end, 10);
+            ok = *end == '\0' && seconds > 0;
+            metricsInterval = std::chrono::seconds(seconds);
+        } else if (ok && args[i] == "--memory-limit") {
+            char* end = nullptr;
+            double mib = std::strtod(args[i + 1].c_str(), &end);
+            ok = *end == '\0' && mib > 0 && contactBook.setMemoryLimit(static_cast<size_t>(mib * 1048576));
+        } else if (ok && args[i] == "--slot-file") {
+            ok = contactBook.setSlotFile(args[i + 1]);
+        } else if (ok && args[i] == "--slow-ms") {
+            char* end = nullptr;
+            double ms = std::strtod(args[i + 1].c_str(), &end);
+            ok = *end == '\0' && ms >= 0;
+            if (ok) contactBook.setSlowOperationThreshold(ms);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Usage: " << argv[0] << " [--record FILE | --replay FILE] [--slow-ms MS]"
+                      << " [--metrics FILE [--metrics-interval SECONDS]] [--memory-limit MIB]\n"
+                      << "       " << std::string(std::strlen(argv[0]), ' ') << " [--slot-file FILE]\n"
+                      << "       " << argv[0] << " --profile-startup\n"
+                      << "       " << argv[0] << " --bench NAME [COUNT]\n";
+            return 1;
+        }
+    }
+    if (!metricsPath.empty()) contactBook.enableMetrics(metricsPath, metricsInterval);
     contactBook.run();
     return 0;
 }
\ No newline at end of file